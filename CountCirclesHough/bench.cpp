@@ -0,0 +1,374 @@
+/*!
+ *
+ * \brief Micro-benchmark of the blur, edge detection and hough kernels.
+ *
+ * Runs every selected kernel in isolation over a sweep of image sizes, radius ranges,
+ * edge densities and thread counts. Every configuration is warmed up, repeated and reported
+ * as min/median/p95/mean nanoseconds, one JSON object per line or one CSV row.
+ *
+ * Build and run:<br>
+ * \code{.sh}
+ * make bench
+ * ./CountCirclesHoughBench -kernels=hough,median,canny -sizes=512,1024 -radii=15-30,30-60 -circles=8,32 -threads=1,2,4 -warmup=2 -reps=10 -out=bench.jsonl
+ * \endcode
+ * Without an image argument, inputs are synthetic (\link synth::render \endlink without noise, occlusion and clutter;
+ * <i>-circles</i> controls the edge density, <i>-seed</i> makes runs reproducible).
+ * With an image argument, the image is used as is and the <i>-sizes</i> and <i>-circles</i> sweeps are skipped.
+ *
+ * \copyright MIT License
+ * \author 97131004
+ */
+
+#include "globals.h"
+#include "blur.h"
+#include "edges.h"
+#include "engine.h"
+#include "metrics.h"
+#include "synth.h"
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+/*! \brief One benchmark configuration. */
+struct bench_config {
+	string kernel; //!< Kernel name: hough, median, median_const, gaussian, canny, sobel, gaussian_sobel
+	int width; //!< Image width
+	int height; //!< Image height
+	int min_radius; //!< Minimum hough radius
+	int max_radius; //!< Maximum hough radius
+	int circles; //!< Synthetic circle count (-1 = input image)
+	int threads; //!< Thread count
+	int edge_cnt; //!< Edge pixels in the hough input
+};
+
+//benchmark parameters
+
+int warmup = 1; //!< Untimed runs before measuring.
+int reps = 5; //!< Timed runs per configuration.
+int seed = 1; //!< Seed of the synthetic image generator.
+ImpType imp_type = ImpType::openmp; //!< Hough implementation type (sequential or OpenMP).
+int blur_ksize = 5; //!< Blur kernel size.
+int edges_ksize = 3; //!< Edge detection kernel size.
+int canny_tresh1 = 100; //!< Canny lower treshold.
+int canny_tresh2 = 200; //!< Canny upper treshold.
+int sobel_bw_tresh = 128; //!< Sobel black-white treshold.
+int peak_tresh = 125; //!< Hough peak treshold.
+bool use_binning = true; //!< Hough binning on/off.
+int bin_size = 32; //!< Hough bin size.
+bool use_spacing = true; //!< Hough spacing on/off.
+int spacing_size = 40; //!< Hough spacing size.
+int tile_size = 0; //!< Hough voting tile size (0 = untiled, -1 = auto).
+AccLayout acc_layout = AccLayout::planar; //!< Hough accumulator layout.
+SimdType simd_type = SimdType::simd_auto; //!< Instruction set of vectorized kernels.
+StencilType stencil_type = StencilType::stencil_angles; //!< Hough voting stencil.
+bool use_normalize = false; //!< Radius-normalized peak scoring on/off.
+MetricsFormat out_format = MetricsFormat::metrics_json; //!< Output format.
+
+/*!
+ * \brief Splits a comma-separated list of integers.
+ * \param list Comma-separated list
+ */
+vector<int> parse_list(const string& list) {
+	vector<int> values;
+	stringstream ss(list);
+	string item;
+	while (getline(ss, item, ',')) {
+		if (!item.empty()) {
+			values.push_back(stoi(item));
+		}
+	}
+	return values;
+}
+
+/*!
+ * \brief Splits a comma-separated list of radius ranges (min-max).
+ * \param list Comma-separated list of ranges
+ */
+vector<pair<int, int>> parse_ranges(const string& list) {
+	vector<pair<int, int>> ranges;
+	stringstream ss(list);
+	string item;
+	while (getline(ss, item, ',')) {
+		size_t dash = item.find('-');
+		if (dash == string::npos) {
+			ranges.push_back(make_pair(stoi(item), stoi(item)));
+		}
+		else {
+			ranges.push_back(make_pair(stoi(item.substr(0, dash)), stoi(item.substr(dash + 1))));
+		}
+	}
+	return ranges;
+}
+
+/*!
+ * \brief Splits a comma-separated list of names.
+ * \param list Comma-separated list
+ */
+vector<string> parse_names(const string& list) {
+	vector<string> names;
+	stringstream ss(list);
+	string item;
+	while (getline(ss, item, ',')) {
+		if (!item.empty()) {
+			names.push_back(item);
+		}
+	}
+	return names;
+}
+
+/*!
+ * \brief Returns the p-th percentile (0..1) of sorted samples (nearest rank).
+ * \param sorted Sorted samples
+ * \param p Percentile
+ */
+long long percentile(const vector<long long>& sorted, const double& p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t rank = (size_t)ceil(p * sorted.size());
+	return sorted[min(sorted.size(), max((size_t)1, rank)) - 1];
+}
+
+/*!
+ * \brief Runs one kernel once.
+ * \param cfg Benchmark configuration
+ * \param gray Grayscale input image
+ * \param edge_img Edge image (hough input)
+ * \param engine Circle detector of the configuration (hough)
+ */
+void run_kernel(const bench_config& cfg, Mat& gray, Mat& edge_img, hough_engine& engine) {
+	if (cfg.kernel == "median") {
+		blur::median(gray, blur_ksize);
+	}
+	else if (cfg.kernel == "median_const") {
+		blur::median_const(gray, blur_ksize, cfg.threads, simd_type);
+	}
+	else if (cfg.kernel == "gaussian") {
+		blur::gaussian(gray, blur_ksize);
+	}
+	else if (cfg.kernel == "canny") {
+		edges::canny(gray, canny_tresh1, canny_tresh2, edges_ksize);
+	}
+	else if (cfg.kernel == "sobel") {
+		edges::sobel(gray, sobel_bw_tresh, edges_ksize);
+	}
+	else if (cfg.kernel == "gaussian_sobel") {
+		edges::gaussian_sobel(gray, blur_ksize, sobel_bw_tresh, edges_ksize, cfg.threads);
+	}
+	else if (cfg.kernel == "hough") {
+		engine.detect(edge_img);
+	}
+}
+
+/*!
+ * \brief Measures one configuration and writes its result.
+ * \param cfg Benchmark configuration
+ * \param gray Grayscale input image
+ * \param edge_img Edge image
+ * \param out Output stream
+ * \param header_written Whether the CSV header was written already
+ */
+void measure(const bench_config& cfg, Mat& gray, Mat& edge_img, ostream& out, bool& header_written) {
+	vector<long long> samples;
+
+	omp_set_num_threads(cfg.threads);
+	cv::setNumThreads(cfg.threads);
+
+	//one detector per configuration, warmup runs allocate its buffers and stencils, timed runs reuse them
+	hough_params params;
+	params.imp_type = imp_type;
+	params.min_radius = cfg.min_radius;
+	params.max_radius = cfg.max_radius;
+	params.peak_tresh = peak_tresh;
+	params.use_binning = use_binning;
+	params.bin_size = bin_size;
+	params.use_spacing = use_spacing;
+	params.spacing_size = spacing_size;
+	params.omp_threads = cfg.threads;
+	params.tile_size = tile_size;
+	params.acc_layout = acc_layout;
+	params.simd_type = simd_type;
+	params.stencil_type = stencil_type;
+	params.use_normalize = use_normalize;
+	hough_engine engine(params);
+
+	for (int i = 0; i < warmup + reps; i++) {
+		long long start = metrics::now();
+		run_kernel(cfg, gray, edge_img, engine);
+		long long elapsed = metrics::now() - start;
+		if (i >= warmup) {
+			samples.push_back(elapsed);
+		}
+	}
+
+	sort(samples.begin(), samples.end());
+	long long sum = 0;
+	for (size_t i = 0; i < samples.size(); i++) {
+		sum += samples[i];
+	}
+	long long mean = samples.empty() ? 0 : sum / (long long)samples.size();
+
+	if (out_format == MetricsFormat::metrics_csv) {
+		if (!header_written) {
+			out << "kernel,width,height,min_radius,max_radius,circles,edge_count,threads,reps,min_ns,median_ns,p95_ns,mean_ns\n";
+			header_written = true;
+		}
+		out << cfg.kernel << "," << cfg.width << "," << cfg.height << "," << cfg.min_radius << "," << cfg.max_radius << ","
+			<< cfg.circles << "," << cfg.edge_cnt << "," << cfg.threads << "," << samples.size() << ","
+			<< percentile(samples, 0.0) << "," << percentile(samples, 0.5) << "," << percentile(samples, 0.95) << "," << mean << "\n";
+	}
+	else {
+		out << "{\"kernel\":\"" << cfg.kernel << "\",\"width\":" << cfg.width << ",\"height\":" << cfg.height
+			<< ",\"min_radius\":" << cfg.min_radius << ",\"max_radius\":" << cfg.max_radius << ",\"circles\":" << cfg.circles
+			<< ",\"edge_count\":" << cfg.edge_cnt << ",\"threads\":" << cfg.threads << ",\"reps\":" << samples.size()
+			<< ",\"min_ns\":" << percentile(samples, 0.0) << ",\"median_ns\":" << percentile(samples, 0.5)
+			<< ",\"p95_ns\":" << percentile(samples, 0.95) << ",\"mean_ns\":" << mean << "}\n";
+	}
+	out.flush();
+}
+
+/*! \brief Command line parameters. */
+const cv::String keys =
+	"{@img||}"
+	"{kernels|hough,median,median_const,gaussian,canny,sobel,gaussian_sobel|}"
+	"{sizes|256,512,1024|}"
+	"{radii|15-30|}"
+	"{circles|4,16,64|}"
+	"{threads|1,2,4|}"
+	"{warmup|1|}"
+	"{reps|5|}"
+	"{seed|1|}"
+	"{imp|1|}"
+	"{blur-ksize|5|}"
+	"{edges-ksize|3|}"
+	"{canny-tresh1|100|}"
+	"{canny-tresh2|200|}"
+	"{sobel-bw-tresh|128|}"
+	"{peak-tresh|125|}"
+	"{use-binning|1|}"
+	"{bin-size|32|}"
+	"{use-spacing|1|}"
+	"{spacing-size|40|}"
+	"{tile-size|0|}"
+	"{acc-layout|0|}"
+	"{simd|3|}"
+	"{stencil|0|}"
+	"{normalize|0|}"
+	"{out||}"
+	"{format|1|}";
+
+/*!
+ * \brief Benchmark entry point.
+ * \param argc Number of strings pointed to by argv
+ * \param argv Array of arguments
+ */
+int main(int argc, char* argv[])
+{
+	cv::CommandLineParser cmd(argc, argv, keys);
+
+	vector<string> kernels = parse_names(cmd.get<string>("kernels"));
+	vector<int> sizes = parse_list(cmd.get<string>("sizes"));
+	vector<pair<int, int>> radii = parse_ranges(cmd.get<string>("radii"));
+	vector<int> circle_cnts = parse_list(cmd.get<string>("circles"));
+	vector<int> thread_cnts = parse_list(cmd.get<string>("threads"));
+
+	warmup = cmd.get<int>("warmup");
+	reps = cmd.get<int>("reps");
+	seed = cmd.get<int>("seed");
+	imp_type = static_cast<ImpType>(cmd.get<int>("imp"));
+	blur_ksize = cmd.get<int>("blur-ksize");
+	edges_ksize = cmd.get<int>("edges-ksize");
+	canny_tresh1 = cmd.get<int>("canny-tresh1");
+	canny_tresh2 = cmd.get<int>("canny-tresh2");
+	sobel_bw_tresh = cmd.get<int>("sobel-bw-tresh");
+	peak_tresh = cmd.get<int>("peak-tresh");
+	use_binning = cmd.get<int>("use-binning");
+	bin_size = cmd.get<int>("bin-size");
+	use_spacing = cmd.get<int>("use-spacing");
+	spacing_size = cmd.get<int>("spacing-size");
+	tile_size = cmd.get<int>("tile-size");
+	acc_layout = static_cast<AccLayout>(cmd.get<int>("acc-layout"));
+	simd_type = static_cast<SimdType>(cmd.get<int>("simd"));
+	stencil_type = static_cast<StencilType>(cmd.get<int>("stencil"));
+	use_normalize = cmd.get<int>("normalize");
+	out_format = static_cast<MetricsFormat>(cmd.get<int>("format"));
+
+	if (imp_type == ImpType::openmpi) {
+		cout << "MPI runs are not supported by the micro-benchmark, use -imp=0 or -imp=1." << endl;
+		return -1;
+	}
+
+	if (kernels.empty() || radii.empty() || thread_cnts.empty() || reps < 1) {
+		cout << "Invalid benchmark parameters." << endl;
+		return -1;
+	}
+
+	//input image: given image, or a synthetic image per size and circle count
+
+	Mat input = Mat();
+	string img_path = cmd.get<string>("@img");
+	if (!img_path.empty()) {
+		input = imread(img_path, IMREAD_GRAYSCALE);
+		if (!input.data) {
+			cout << "Input data invalid." << endl;
+			return -1;
+		}
+		sizes = vector<int>(1, input.cols);
+		circle_cnts = vector<int>(1, -1);
+	}
+
+	ofstream out_file;
+	string out_path = cmd.get<string>("out");
+	if (!out_path.empty()) {
+		out_file.open(out_path, ios_base::app);
+	}
+	ostream& out = out_path.empty() ? cout : out_file;
+	bool header_written = !out_path.empty() && ifstream(out_path).peek() != ifstream::traits_type::eof();
+
+	for (size_t s = 0; s < sizes.size(); s++) {
+		for (size_t c = 0; c < circle_cnts.size(); c++) {
+			for (size_t r = 0; r < radii.size(); r++) {
+
+				//prepare inputs (not timed): hough runs on the edges of the blurred image
+
+				Mat gray;
+				vector<tuple<int, int, int>> truth;
+				if (input.data) {
+					gray = input;
+				}
+				else {
+					cv::cvtColor(synth::render(sizes[s], sizes[s], circle_cnts[c], radii[r].first, radii[r].second, 0, 0, 0, seed, truth), gray, COLOR_BGR2GRAY);
+				}
+				Mat blurred = blur::median(gray, blur_ksize);
+				Mat edge_img = edges::canny(blurred, canny_tresh1, canny_tresh2, edges_ksize);
+
+				bench_config cfg;
+				cfg.width = gray.cols;
+				cfg.height = gray.rows;
+				cfg.min_radius = radii[r].first;
+				cfg.max_radius = radii[r].second;
+				cfg.circles = circle_cnts[c];
+				cfg.edge_cnt = countNonZero(edge_img);
+
+				for (size_t k = 0; k < kernels.size(); k++) {
+
+					//blur and edge kernels don't depend on the radius range, measure them once
+
+					if (kernels[k] != "hough" && r > 0) {
+						continue;
+					}
+
+					cfg.kernel = kernels[k];
+
+					for (size_t t = 0; t < thread_cnts.size(); t++) {
+						cfg.threads = thread_cnts[t];
+						measure(cfg, gray, edge_img, out, header_written);
+					}
+				}
+			}
+		}
+	}
+
+	return 0;
+}
@@ -23,3 +23,125 @@ Mat blur::median(Mat& src, const int& ksize)
 	cv::medianBlur(src, blurred, ksize);
 	return blurred;
 }
+
+
+/*!
+ * \brief Constant-time median filter of a horizontal strip of rows (replicated borders, as medianBlur).
+		  Every column keeps a histogram of its ksize rows, sliding down by one pixel per row.
+		  The kernel histogram slides right by adding the entering and subtracting the leaving column histogram,
+		  so the cost per pixel does not depend on the kernel size. The kernel histogram of the first pixel
+		  of a row follows the column slides of its r + 1 columns, so starting a row does not depend on it either.
+		  A 16-bin coarse histogram narrows the median search to one 16-bin range of the fine histogram.
+ * \param src Input image (8-bit, 1 channel)
+ * \param dst Output image
+ * \param r Kernel radius (ksize / 2)
+ * \param y1 First row of the strip
+ * \param y2 End row of the strip (exclusive)
+ * \param simd_type SIMD type to run
+ */
+void blur::median_const_strip(const Mat& src, Mat& dst, const int& r, const int& y1, const int& y2, const SimdType& simd_type) {
+	int w = src.cols;
+	int h = src.rows;
+	int rank = ((2 * r + 1) * (2 * r + 1)) / 2; //0-based rank of the median
+
+	vector<ushort> col_fine(w * 256, 0), col_coarse(w * 16, 0); //column histograms
+	vector<ushort> fine(256), coarse(16); //kernel histograms
+	vector<ushort> seed_fine(256, 0), seed_coarse(16, 0); //kernel histograms of the first pixel of the current row
+	vector<ushort> zero(256, 0);
+	vector<int> seed_mult(w, 0); //times a column is part of the first kernel (left border replicated)
+
+	//column histograms of the first row
+	for (int k = -r; k <= r; k++) {
+		const uchar* row = src.ptr<uchar>(min(h - 1, max(0, y1 + k)));
+		for (int x = 0; x < w; x++) {
+			col_fine[x * 256 + row[x]]++;
+			col_coarse[x * 16 + (row[x] >> 4)]++;
+		}
+	}
+
+	//kernel histogram of the first pixel of the first row
+	for (int k = -r; k <= r; k++) {
+		int c = min(w - 1, max(0, k));
+		seed_mult[c]++;
+		simd::hist_update(seed_fine.data(), &col_fine[c * 256], zero.data(), 256, simd_type);
+		simd::hist_update(seed_coarse.data(), &col_coarse[c * 16], zero.data(), 16, simd_type);
+	}
+
+	for (int y = y1; y < y2; y++) {
+
+		//slide column histograms down (and the first kernel histogram along with its columns)
+		if (y > y1) {
+			const uchar* row_out = src.ptr<uchar>(min(h - 1, max(0, y - r - 1)));
+			const uchar* row_in = src.ptr<uchar>(min(h - 1, max(0, y + r)));
+			for (int x = 0; x < w; x++) {
+				if (row_out[x] != row_in[x]) {
+					col_fine[x * 256 + row_out[x]]--;
+					col_coarse[x * 16 + (row_out[x] >> 4)]--;
+					col_fine[x * 256 + row_in[x]]++;
+					col_coarse[x * 16 + (row_in[x] >> 4)]++;
+				}
+			}
+			for (int c = 0; c <= min(w - 1, r); c++) {
+				if (row_out[c] != row_in[c]) {
+					seed_fine[row_out[c]] -= seed_mult[c];
+					seed_coarse[row_out[c] >> 4] -= seed_mult[c];
+					seed_fine[row_in[c]] += seed_mult[c];
+					seed_coarse[row_in[c] >> 4] += seed_mult[c];
+				}
+			}
+		}
+
+		//kernel histogram of the first pixel
+		copy(seed_fine.begin(), seed_fine.end(), fine.begin());
+		copy(seed_coarse.begin(), seed_coarse.end(), coarse.begin());
+
+		uchar* out = dst.ptr<uchar>(y);
+		for (int x = 0; x < w; x++) {
+
+			//slide kernel histogram right
+			if (x > 0) {
+				int c_in = min(w - 1, x + r);
+				int c_out = max(0, x - r - 1);
+				if (c_in != c_out) {
+					simd::hist_update(fine.data(), &col_fine[c_in * 256], &col_fine[c_out * 256], 256, simd_type);
+					simd::hist_update(coarse.data(), &col_coarse[c_in * 16], &col_coarse[c_out * 16], 16, simd_type);
+				}
+			}
+
+			//median: coarse bin first, then fine bin inside it
+			int cnt = 0;
+			int b = 0;
+			while (cnt + coarse[b] <= rank) {
+				cnt += coarse[b++];
+			}
+			int v = b * 16;
+			while (cnt + fine[v] <= rank) {
+				cnt += fine[v++];
+			}
+			out[x] = (uchar)v;
+		}
+	}
+}
+
+/*!
+ * \brief Performing a constant-time median filter on an image (same result as median,
+		  but the cost per pixel does not grow with the kernel size). Strips of rows run in parallel with OpenMP.
+ * \param src Input image (8-bit, 1 channel)
+ * \param ksize Kernel size (must be odd)
+ * \param omp_threads Number of OpenMP threads
+ * \param simd_type SIMD type of the histogram updates (simd_auto picks the widest available)
+ */
+Mat blur::median_const(Mat& src, const int& ksize, const int& omp_threads, const SimdType& simd_type)
+{
+	Mat blurred(src.rows, src.cols, CV_8UC1);
+	SimdType simd_run = simd::resolve(simd_type);
+
+	//strips of at least 32 rows, so initializing the column histograms stays a small fraction
+	int strips = max(1, min(omp_threads, src.rows / 32));
+
+	#pragma omp parallel for num_threads(strips) schedule(static)
+	for (int i = 0; i < strips; i++) {
+		median_const_strip(src, blurred, ksize / 2, (src.rows * i) / strips, (src.rows * (i + 1)) / strips, simd_run);
+	}
+	return blurred;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "globals.h"
+#include "simd.h"
 
 /*!
  * \brief Collection of blur filtering functions.
@@ -9,8 +10,12 @@
  */
 class blur
 {
+private:
+	static void median_const_strip(const Mat& src, Mat& dst, const int& r, const int& y1, const int& y2, const SimdType& simd_type);
+
 public:
 	static Mat gaussian(Mat& src, const int& ksize = 3);
 	static Mat median(Mat& src, const int& ksize = 5);
+	static Mat median_const(Mat& src, const int& ksize = 5, const int& omp_threads = 2, const SimdType& simd_type = SimdType::simd_auto);
 };
 
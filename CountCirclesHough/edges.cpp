@@ -51,4 +51,153 @@ Mat edges::sobel(Mat& src, const int& tresh_bw, const int& ksize) {
 	cv::threshold(grad, grad, tresh_bw, 255.0, THRESH_BINARY);
 
 	return grad;
-}
\ No newline at end of file
+}
+
+/*!
+ * \brief Computes one row of a gaussian blurred image (vertical, then horizontal pass, mirrored borders).
+ * \param src Input image (8-bit, 1 channel)
+ * \param y Row index (inside the image)
+ * \param kernel Gaussian kernel (odd length)
+ * \param col_buf Buffer for the vertically blurred row (image width)
+ * \param dst Output blurred row (image width)
+ */
+void edges::gaussian_row(const Mat& src, const int& y, const vector<float>& kernel, float* col_buf, uchar* dst) {
+	int w = src.cols;
+	int half = (int)kernel.size() / 2;
+
+	for (int x = 0; x < w; x++) {
+		col_buf[x] = 0;
+	}
+	for (int k = -half; k <= half; k++) {
+		const uchar* row = src.ptr<uchar>(borderInterpolate(y + k, src.rows, BORDER_REFLECT_101));
+		float c = kernel[k + half];
+		for (int x = 0; x < w; x++) {
+			col_buf[x] += c * row[x];
+		}
+	}
+
+	for (int x = 0; x < w; x++) {
+		float sum = 0;
+		for (int k = -half; k <= half; k++) {
+			sum += kernel[k + half] * col_buf[borderInterpolate(x + k, w, BORDER_REFLECT_101)];
+		}
+		dst[x] = (uchar)min(255, (int)(sum + 0.5f));
+	}
+}
+
+/*!
+ * \brief Fused gaussian blur and sobel filter of a horizontal strip of rows.
+		  Blurred rows are kept in a ring buffer of ksize rows only, so every input row is read
+		  from memory once and all intermediate rows stay in cache.
+ * \param src Input image (8-bit, 1 channel)
+ * \param dst Output binary edge image
+ * \param dir Output gradient direction image (nullptr = none)
+ * \param y1 First row of the strip
+ * \param y2 End row of the strip (exclusive)
+ * \param gauss Gaussian kernel
+ * \param deriv Sobel derivative kernel
+ * \param smooth Sobel smoothing kernel
+ * \param tresh_bw Treshold for black/white (binary) image generation
+ */
+void edges::gaussian_sobel_strip(const Mat& src, Mat& dst, Mat* dir, const int& y1, const int& y2,
+	const vector<float>& gauss, const vector<int>& deriv, const vector<int>& smooth, const int& tresh_bw) {
+
+	int w = src.cols;
+	int h = src.rows;
+	int half = (int)deriv.size() / 2;
+	int ring_size = 2 * half + 1;
+
+	vector<float> col_buf(w);
+	vector<uchar> ring(ring_size * w);
+	vector<int> ring_row(ring_size, -1); //blurred row index held by each ring slot
+	vector<int> v_smooth(w), v_deriv(w);
+
+	for (int y = y1; y < y2; y++) {
+
+		//vertical sobel pass over the blurred rows y-half..y+half (mirrored borders)
+		for (int x = 0; x < w; x++) {
+			v_smooth[x] = 0;
+			v_deriv[x] = 0;
+		}
+		for (int k = -half; k <= half; k++) {
+			int row_ind = borderInterpolate(y + k, h, BORDER_REFLECT_101);
+			int slot = row_ind % ring_size;
+			uchar* row = &ring[slot * w];
+			if (ring_row[slot] != row_ind) {
+				gaussian_row(src, row_ind, gauss, col_buf.data(), row);
+				ring_row[slot] = row_ind;
+			}
+			int cs = smooth[k + half];
+			int cd = deriv[k + half];
+			for (int x = 0; x < w; x++) {
+				v_smooth[x] += cs * row[x];
+				v_deriv[x] += cd * row[x];
+			}
+		}
+
+		//horizontal sobel pass, magnitude (as in sobel: mean of saturated absolute gradients) and treshold
+		uchar* out = dst.ptr<uchar>(y);
+		short* out_dir = (dir != nullptr) ? dir->ptr<short>(y) : nullptr;
+		for (int x = 0; x < w; x++) {
+			int gx = 0, gy = 0;
+			for (int k = -half; k <= half; k++) {
+				int xi = borderInterpolate(x + k, w, BORDER_REFLECT_101);
+				gx += deriv[k + half] * v_smooth[xi];
+				gy += smooth[k + half] * v_deriv[xi];
+			}
+			//halves are rounded to even, as addWeighted does
+			int sum = min(abs(gx), 255) + min(abs(gy), 255);
+			int mag = (sum >> 1) + ((sum & 1) & ((sum >> 1) & 1));
+			out[x] = (mag > tresh_bw) ? 255 : 0;
+			if (out_dir != nullptr) {
+				out_dir[x] = out[x] ? (short)fastAtan2((float)gy, (float)gx) : 0;
+			}
+		}
+	}
+}
+
+/*!
+ * \brief Gaussian blur followed by sobel edge detection, fused into one row-streaming pass
+		  (no intermediate blurred or gradient images). Strips of rows run in parallel with OpenMP.
+		  Produces the same edge image as blur::gaussian followed by edges::sobel, up to rounding of the blur.
+ * \param src Input image (8-bit, 1 channel)
+ * \param blur_ksize Gaussian kernel size (must be odd)
+ * \param tresh_bw Treshold for black/white (binary) image generation
+ * \param ksize Sobel kernel size (must be 3, 5 or 7)
+ * \param omp_threads Number of OpenMP threads
+ * \param dir Output gradient direction in degrees (0-359, 16-bit, towards brighter pixels), 0 for non-edge pixels
+		  (nullptr = not computed)
+ * \return Binary edge image
+ */
+Mat edges::gaussian_sobel(Mat& src, const int& blur_ksize, const int& tresh_bw, const int& ksize, const int& omp_threads, Mat* dir) {
+
+	Mat dst(src.rows, src.cols, CV_8UC1);
+	if (dir != nullptr) {
+		dir->create(src.rows, src.cols, CV_16SC1);
+	}
+
+	//same kernels as GaussianBlur (sigma derived from ksize) and Sobel
+	Mat gauss_k = getGaussianKernel(blur_ksize, 0, CV_32F);
+	Mat deriv_k, smooth_k;
+	getDerivKernels(deriv_k, smooth_k, 1, 0, ksize, false, CV_32F);
+
+	vector<float> gauss(blur_ksize);
+	vector<int> deriv(ksize), smooth(ksize);
+	for (int k = 0; k < blur_ksize; k++) {
+		gauss[k] = gauss_k.at<float>(k);
+	}
+	for (int k = 0; k < ksize; k++) {
+		deriv[k] = cvRound(deriv_k.at<float>(k));
+		smooth[k] = cvRound(smooth_k.at<float>(k));
+	}
+
+	//strips of at least 32 rows, so the recomputed halo rows stay a small fraction
+	int strips = max(1, min(omp_threads, src.rows / 32));
+
+	#pragma omp parallel for num_threads(strips) schedule(static)
+	for (int i = 0; i < strips; i++) {
+		gaussian_sobel_strip(src, dst, dir, (src.rows * i) / strips, (src.rows * (i + 1)) / strips, gauss, deriv, smooth, tresh_bw);
+	}
+
+	return dst;
+}
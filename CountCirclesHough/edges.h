@@ -9,8 +9,14 @@
  */
 class edges
 {
+private:
+	static void gaussian_row(const Mat& src, const int& y, const vector<float>& kernel, float* col_buf, uchar* dst);
+	static void gaussian_sobel_strip(const Mat& src, Mat& dst, Mat* dir, const int& y1, const int& y2,
+		const vector<float>& gauss, const vector<int>& deriv, const vector<int>& smooth, const int& tresh_bw);
+
 public:
 	static Mat canny(Mat& src, const int& tresh1, const int& tresh2, const int& ksize = 3);
 	static Mat sobel(Mat& src, const int& tresh_bw, const int& ksize = 3);
+	static Mat gaussian_sobel(Mat& src, const int& blur_ksize, const int& tresh_bw, const int& ksize = 3, const int& omp_threads = 2, Mat* dir = nullptr);
 };
 
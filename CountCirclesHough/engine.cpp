@@ -0,0 +1,77 @@
+#include "engine.h"
+
+/*!
+ * \brief Creates a detector. With ImpType::openmpi, MPI has to be initialized and all processes
+		  of MPI_COMM_WORLD have to call \link hough_engine::detect \endlink together.
+ * \param params Transformation parameters
+ */
+hough_engine::hough_engine(const hough_params& params) {
+	set_params(params);
+}
+
+/*!
+ * \brief Replaces the transformation parameters. Buffers are kept and grown on demand.
+ * \param params Transformation parameters
+ */
+void hough_engine::set_params(const hough_params& params) {
+	prm = params;
+	world_size = 1;
+	world_rank = 0;
+	if (prm.imp_type == ImpType::openmpi) {
+		MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+		MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+	}
+}
+
+/*!
+ * \brief Returns the transformation parameters.
+ * \return Transformation parameters
+ */
+const hough_params& hough_engine::params() const {
+	return prm;
+}
+
+/*!
+ * \brief Detects circles in an edge image (255 = edge).
+		  Adds its stages and counters to the current run (see \link hough_engine::begin_run \endlink).
+ * \param edges Edge image (8-bit, single channel)
+ * \return Found circles and execution times, valid until the next call
+ */
+const hough_result& hough_engine::detect(Mat& edges) {
+	hough::detect(edges, prm, world_size, world_rank, bufs, res, run, mem);
+	hough::record(res, times);
+	return res;
+}
+
+/*!
+ * \brief Returns the runtime statistics of all detections (lock-free, readable while detecting).
+ * \return Runtime statistics
+ */
+hough_stats& hough_engine::stats() {
+	return times;
+}
+
+/*!
+ * \brief Starts a new run of the metrics (persistent stages are kept) and of the buffer accounting.
+ */
+void hough_engine::begin_run() {
+	metrics::begin_run(run);
+	memtrack::begin_run(mem);
+}
+
+/*!
+ * \brief Returns the metrics of the current run. Callers may add their own stages (e.g. preprocessing);
+		  not to be touched while this detector is detecting.
+ * \return Run metrics
+ */
+run_metrics& hough_engine::metrics() {
+	return run;
+}
+
+/*!
+ * \brief Frees all working buffers (they are reallocated by the next detection).
+ */
+void hough_engine::release() {
+	hough::free_buffers(bufs, mem);
+	bufs = hough_buffers();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "hough.h"
+
+/*!
+ * \brief Reusable circle detector for embedding: keeps parameters, working buffers and voting stencils
+		  between detections, so repeated calls pay no per-call setup. Draws and prints nothing.
+		  Records the runtimes of every detection into its own fixed-size statistics, and its stages, counters
+		  and buffer bytes into its own run metrics, so detectors on different threads never share (or lock) any record.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class hough_engine
+{
+private:
+	hough_params prm;
+	hough_buffers bufs;
+	hough_result res;
+	hough_stats times;
+	run_metrics run;
+	mem_account mem;
+	int world_size;
+	int world_rank;
+
+public:
+	hough_engine(const hough_params& params = hough_params());
+
+	void set_params(const hough_params& params);
+	const hough_params& params() const;
+	const hough_result& detect(Mat& edges);
+	hough_stats& stats();
+	void begin_run();
+	run_metrics& metrics();
+	void release();
+};
@@ -2,13 +2,20 @@
 
 #include <iostream>
 #include <cstdio>
+#include <cstring>
 #include <chrono>
+#include <atomic>
 #include <exception>
 #include <thread>
 #include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
 #include <stdlib.h>
 #include <stdio.h>
 #include <vector>
+#include <limits>
+#include <unistd.h>
 #include <omp.h>
 #include "mpi.h"
 #include <opencv2/opencv.hpp>
@@ -25,28 +32,62 @@ using namespace std;
 enum ImpType { 
 	sequential, /**< Sequential execution with no parallization */ 
 	openmp, /**< Parallelization with OpenMP */ 
-	openmpi  /**< Parallelization with OpenMPI */ 
+	openmpi,  /**< Parallelization with OpenMPI */ 
+	automatic /**< Predicted-fastest type, picked by the planner after edge detection */
 };
 
 /*! \brief MPI field size to send and receive. */
 enum MpiType {
 	full, /**< Send full-sized image and receive full-sized accumulator matrix */
-	crop /**< Send cropped image and receive cropped accumulator matrix */ 
+	crop, /**< Send cropped image and receive cropped accumulator matrix */ 
+	rows /**< Send horizontal image stripes and receive accumulator row slabs (contiguous per radius plane) */
 };
 
 /*! \brief Blur filter type to apply to the image. */
 enum BlurType { 
 	median, /**< Median Filter */
-	gaussian /**< Gaussian Blur */
+	gaussian, /**< Gaussian Blur */
+	median_const /**< Constant-time Median Filter (sliding histograms, for large kernels) */
 };
 
 /*! \brief Edge detection algorithm to run on the image. */
 enum EdgesType { 
 	sobel, /**< Sobel Filter */
-	canny /**< Canny Edge Detector */
+	canny, /**< Canny Edge Detector */
+	gaussian_sobel /**< Gaussian Blur and Sobel Filter fused into one pass (replaces the blur filter) */
+};
+
+/*! \brief Accumulator counter type (element width). */
+enum AccType {
+	acc_u8, /**< 8-bit counters, saturating */
+	acc_u16, /**< 16-bit counters */
+	acc_u32 /**< 32-bit counters */
+};
+
+/*! \brief Memory layout of the 3D hough accumulator. */
+enum AccLayout {
+	planar, /**< X-fastest, then Y, then radius (one image-sized plane per radius) */
+	radius_inner /**< Radius-fastest, then X, then Y (all radii of a circle center are adjacent) */
+};
+
+/*! \brief Instruction set used by the vectorized kernels. */
+enum SimdType {
+	simd_scalar, /**< Scalar fallback (reference for verification) */
+	simd_avx2, /**< AVX2 (256 bit) */
+	simd_avx512, /**< AVX-512F + AVX-512BW (512 bit) */
+	simd_auto /**< Widest instruction set supported by the running CPU */
+};
+
+/*! \brief Circle stencil each edge pixel votes with. */
+enum StencilType {
+	stencil_angles, /**< One vote per degree (361 per radius, duplicates for small radii, gaps for large radii) */
+	stencil_midpoint /**< One vote per unique circle pixel (midpoint circle), proportional to circumference */
+};
+
+/*! \brief Output format of per-run metrics. */
+enum MetricsFormat {
+	metrics_none, /**< No metrics output */
+	metrics_json, /**< One JSON object per line (JSON lines) */
+	metrics_csv /**< One CSV row per run */
 };
 
-/*! \brief Globally-accessible fields. */
-namespace globals {
-	extern vector<tuple<long long, long long, long long>> runtimes;
-}
@@ -1,18 +1,21 @@
 #include "hough.h"
 
+const int hough::angles_cnt;
+const int hough::occ_block;
+const long long hough::norm_ref;
+
+/*! \brief Accumulator fingerprint (acc_hash counter) on/off. */
+bool hough::hash_enabled = false;
+
 /*!
- * \brief Fills image into a 2D-array (represented as 1D-array).
- * \param arr Destination 2D-array (represnted as 1D-array)
- * \param img Source image
- * \param width Image width
- * \param height Image height
+ * \brief Turns the accumulator fingerprint on or off. The root records an FNV-1a hash of the merged
+		  accumulator (image area only, radius/row/column order, so independent of layout and MPI halos)
+		  as the acc_hash counter. Runs with different implementation types, MPI types, thread counts,
+		  layouts and SIMD types must report the same value.
+ * \param on Fingerprint on/off
  */
-void hough::fill_img_into_2d_array(uchar* arr, const Mat& img, const int& width, const int& height) {
-	for (int i = 0; i < height; ++i) {
-		for (int j = 0; j < width; ++j) {
-			arr[width * i + j] = (uchar)img.at<uchar>(i, j);
-		}
-	}
+void hough::enable_acc_hash(const bool& on) {
+	hash_enabled = on;
 }
 
 /*!
@@ -55,16 +58,1019 @@ void hough::ind_1d_to_3d(int ind, int& x, int& y, int& z, const int& width, cons
 	x = ind % width;
 }
 
+/*!
+ * \brief Converts 3D-array index to 1D-array index using per-axis strides.
+ * \param ind Output 1D-array index
+ * \param x Input 3D-array X-index
+ * \param y Input 3D-array Y-index
+ * \param z Input 3D-array Z-index
+ * \param strides 3D-array strides
+ */
+void hough::ind_3d_to_1d(int& ind, const int& x, const int& y, const int& z, const acc_strides& strides) {
+	ind = x * strides.x + y * strides.y + z * strides.z;
+}
+
+/*!
+ * \brief Returns the strides of a 3D accumulator for the given memory layout.
+ * \param width 3D-array width
+ * \param height 3D-array height
+ * \param depth 3D-array depth
+ * \param layout Accumulator memory layout
+ * \return 3D-array strides
+ */
+acc_strides hough::get_acc_strides(const int& width, const int& height, const int& depth, const AccLayout& layout) {
+	if (layout == AccLayout::radius_inner) {
+		return { depth, depth * width, 1 };
+	}
+	return { 1, width, width * height };
+}
+
+/*!
+ * \brief Precomputes cosine and sine for every voted angle (0-360 degrees) as Q16 fixed-point values.
+		  Voting offsets are derived from these integers only, so they do not depend on floating-point
+		  evaluation order (SIMD width, compiler).
+ * \param cos_q Output cosine table (angles_cnt entries, Q16)
+ * \param sin_q Output sine table (angles_cnt entries, Q16)
+ */
+void hough::fill_trig_tables(int* cos_q, int* sin_q) {
+	for (int t = 0; t < angles_cnt; t++) {
+		cos_q[t] = (int)lround(cos((t * CV_PI) / 180.0) * 65536.0);
+		sin_q[t] = (int)lround(sin((t * CV_PI) / 180.0) * 65536.0);
+	}
+}
+
+/*!
+ * \brief Generates the deduplicated integer circle stencil of one radius (midpoint circle algorithm).
+		  Every pixel of the 8-connected circle appears exactly once, so the point count grows
+		  with the circumference. Points are sorted row by row for locality of the voting writes.
+ * \param r Radius
+ * \param pts Output stencil points
+ */
+void hough::fill_stencil_midpoint(const int& r, vector<Point>& pts) {
+	int x = r;
+	int y = 0;
+	int err = 1 - r;
+
+	pts.clear();
+	while (x >= y) {
+		//8-way symmetry
+		pts.push_back(Point(x, y));
+		pts.push_back(Point(y, x));
+		pts.push_back(Point(-y, x));
+		pts.push_back(Point(-x, y));
+		pts.push_back(Point(-x, -y));
+		pts.push_back(Point(-y, -x));
+		pts.push_back(Point(y, -x));
+		pts.push_back(Point(x, -y));
+
+		y++;
+		if (err < 0) {
+			err += 2 * y + 1;
+		}
+		else {
+			x--;
+			err += 2 * (y - x) + 1;
+		}
+	}
+
+	//points on the axes and diagonals are generated more than once
+	sort(pts.begin(), pts.end(), [](const Point& a, const Point& b) { return (a.y != b.y) ? a.y < b.y : a.x < b.x; });
+	pts.erase(unique(pts.begin(), pts.end(), [](const Point& a, const Point& b) { return a.x == b.x && a.y == b.y; }), pts.end());
+}
+
+/*!
+ * \brief Precomputes integer voting X/Y-offsets of every radius.
+		  Angle stencils vote once per degree (361 offsets per radius, duplicates included, rounded to nearest),
+		  midpoint stencils vote once per unique circle pixel.
+ * \param offs Output voting offsets
+ * \param min_radius Minimum circle radius
+ * \param max_radius Maximum circle radius
+ * \param stencil_type Voting stencil type
+ * \param simd_type SIMD type to run
+ */
+void hough::fill_acc_offsets(acc_offsets& offs, const int& min_radius, const int& max_radius, const StencilType& stencil_type, const SimdType& simd_type) {
+	int cos_q[angles_cnt], sin_q[angles_cnt];
+	vector<Point> pts;
+	int acc_d = max_radius - min_radius + 1;
+
+	offs.start.assign(acc_d + 1, 0);
+	offs.dx.clear();
+	offs.dy.clear();
+	offs.reach = 0;
+	offs.stencil_max = 0;
+	offs.mult_max = 0;
+
+	if (stencil_type == StencilType::stencil_angles) {
+		fill_trig_tables(cos_q, sin_q);
+		offs.dx.resize(acc_d * angles_cnt);
+		offs.dy.resize(acc_d * angles_cnt);
+	}
+
+	for (int z = 0; z < acc_d; z++) {
+		if (stencil_type == StencilType::stencil_angles) {
+			offs.start[z + 1] = offs.start[z] + angles_cnt;
+			simd::radius_offsets(cos_q, sin_q, angles_cnt, z + min_radius, &offs.dx[offs.start[z]], &offs.dy[offs.start[z]], simd_type);
+		}
+		else {
+			fill_stencil_midpoint(z + min_radius, pts);
+			offs.start[z + 1] = offs.start[z] + (int)pts.size();
+			for (size_t k = 0; k < pts.size(); k++) {
+				offs.dx.push_back(pts[k].x);
+				offs.dy.push_back(pts[k].y);
+			}
+		}
+	}
+
+	for (int k = 0; k < offs.start[acc_d]; k++) {
+		offs.reach = max(offs.reach, max(abs(offs.dx[k]), abs(offs.dy[k])));
+	}
+
+	//stencil rows: X-range of the offsets of each radius and Y-offset (occupancy is marked once per row);
+	//sorted offsets also give the largest stencil and the largest offset multiplicity (bound of votes per bin)
+	offs.row_start.assign(acc_d + 1, 0);
+	offs.row_dy.clear();
+	offs.row_dx1.clear();
+	offs.row_dx2.clear();
+	for (int z = 0; z < acc_d; z++) {
+		pts.clear();
+		for (int k = offs.start[z]; k < offs.start[z + 1]; k++) {
+			pts.push_back(Point(offs.dx[k], offs.dy[k]));
+		}
+		sort(pts.begin(), pts.end(), [](const Point& a, const Point& b) { return (a.y != b.y) ? a.y < b.y : a.x < b.x; });
+		offs.stencil_max = max(offs.stencil_max, (int)pts.size());
+		for (size_t k = 0, mult = 0; k < pts.size(); k++) {
+			mult = (k > 0 && pts[k].x == pts[k - 1].x && pts[k].y == pts[k - 1].y) ? mult + 1 : 1;
+			offs.mult_max = max(offs.mult_max, (int)mult);
+			if (k == 0 || pts[k].y != pts[k - 1].y) {
+				offs.row_dy.push_back(pts[k].y);
+				offs.row_dx1.push_back(pts[k].x);
+				offs.row_dx2.push_back(pts[k].x);
+			}
+			else {
+				offs.row_dx2.back() = pts[k].x;
+			}
+		}
+		offs.row_start[z + 1] = (int)offs.row_dy.size();
+	}
+}
+
+/*!
+ * \brief Computes 1D-array voting offsets inside a radius plane (used by interior pixels, which need no bounds checks),
+		  of single votes and of the first and last bin of every stencil row.
+ * \param offs Voting offsets (X/Y-offsets and stencil rows already filled)
+ * \param strides Accumulator strides
+ */
+void hough::fill_lin_offsets(acc_offsets& offs, const acc_strides& strides) {
+	offs.lin.resize(offs.dx.size());
+	for (size_t k = 0; k < offs.dx.size(); k++) {
+		offs.lin[k] = offs.dx[k] * strides.x + offs.dy[k] * strides.y;
+	}
+	offs.row_lin1.resize(offs.row_dy.size());
+	offs.row_lin2.resize(offs.row_dy.size());
+	for (size_t k = 0; k < offs.row_dy.size(); k++) {
+		offs.row_lin1[k] = offs.row_dx1[k] * strides.x + offs.row_dy[k] * strides.y;
+		offs.row_lin2[k] = offs.row_dx2[k] * strides.x + offs.row_dy[k] * strides.y;
+	}
+}
+
+/*!
+ * \brief Marks all occupancy blocks of a range of accumulator bins as occupied
+		  (atomic stores: a block may straddle the bin windows of two tiles voting concurrently).
+ * \param occ_map Occupancy map, one byte per block of occ_block bins
+ * \param ind1 First bin of the range
+ * \param ind2 Last bin of the range
+ */
+inline void hough::mark_occupied(uchar* occ_map, const int& ind1, const int& ind2) {
+	for (int b = ind1 / occ_block; b <= ind2 / occ_block; b++) {
+		#pragma omp atomic write
+		occ_map[b] = 1;
+	}
+}
+
+/*!
+ * \brief Collects coordinates of all edge pixels (255 = white) inside an image region.
+ * \param edge_pts Output list of edge pixel coordinates
+ * \param src Image rows
+ * \param src_step Image row stride in bytes
+ * \param x1 Region start X-index
+ * \param x2 Region end X-index (exclusive)
+ * \param y1 Region start Y-index
+ * \param y2 Region end Y-index (exclusive)
+ * \param simd_type SIMD type to run
+ */
+void hough::compact_edges(vector<Point>& edge_pts, const uchar* src, const int& src_step, const int& x1, const int& x2, const int& y1, const int& y2, const SimdType& simd_type) {
+	vector<int> xs(max(0, x2 - x1));
+
+	edge_pts.clear();
+	for (int j = y1; j < y2; j++) {
+		int cnt = simd::find_edges(src + (size_t)src_step * j, x1, x2, xs.data(), simd_type);
+		for (int k = 0; k < cnt; k++) {
+			edge_pts.push_back(Point(xs[k], j));
+		}
+	}
+}
+
+/*!
+ * \brief Picks a tile edge length so that the accumulator window touched by one tile
+		  (tile + 2 * max_radius in X and Y, over all radii) fits into the L2 cache.
+		  Images no larger than one tile (e.g. money1.png, 90x90, at r = 15..30 with 1 MB of L2) get a single tile, so tiling changes nothing for them.
+ * \param max_radius Maximum circle radius
+ * \param acc_d Accumulator depth
+ * \param elem_size Size of an accumulator counter in bytes
+ * \return Tile edge length in pixels
+ */
+int hough::tile_size_auto(const int& max_radius, const int& acc_d, const int& elem_size) {
+	long l2_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	if (l2_size <= 0) {
+		l2_size = 1024 * 1024; //fallback if the cache size is not reported
+	}
+
+	//use half of L2, leaving room for the edge list and other data
+	int window = (int)sqrt((l2_size / 2.0) / ((double)acc_d * elem_size));
+	return max(16, window - (2 * max_radius));
+}
+
+/*!
+ * \brief Votes for all circles of radii r1 to r2 passing through an edge pixel.
+		  Pixels farther than the offset reach from the accumulator border vote through
+		  precomputed 1D-array offsets without bounds checks.
+ * \tparam T Accumulator counter type
+ * \param acc Accumulator 1D-array
+ * \param occ_map Occupancy map, one byte per block of occ_block bins, marked once per stencil row and radius
+		  over the row's X-range (may mark blocks between the votes of a row, which then stay zero)
+ * \param strides Accumulator strides
+ * \param offs Voting offsets
+ * \param x Edge pixel X-index in accumulator coordinates
+ * \param y Edge pixel Y-index in accumulator coordinates
+ * \param r1 First radius to vote for
+ * \param r2 Last radius to vote for
+ * \param min_radius Minimum circle radius (accumulator Z-index 0)
+ * \param acc_w Accumulator width
+ * \param acc_h Accumulator height
+ * \return Number of votes cast
+ */
+template <typename T>
+inline long long hough::vote_pixel(T* acc, uchar* occ_map, const acc_strides& strides, const acc_offsets& offs,
+	const int& x, const int& y, const int& r1, const int& r2, const int& min_radius, const int& acc_w, const int& acc_h) {
+
+	int hough_x, hough_y;
+	long long votes = 0;
+	bool inside = (x - offs.reach >= 0 && x + offs.reach < acc_w && y - offs.reach >= 0 && y + offs.reach < acc_h);
+
+	for (int z = r1 - min_radius; z <= r2 - min_radius; z++) {
+		int k1 = offs.start[z];
+		int k2 = offs.start[z + 1];
+
+		if (inside) {
+			int center = z * strides.z + x * strides.x + y * strides.y;
+			for (int k = k1; k < k2; k++) {
+				acc_vote(acc[center + offs.lin[k]]);
+			}
+			for (int k = offs.row_start[z]; k < offs.row_start[z + 1]; k++) {
+				mark_occupied(occ_map, center + offs.row_lin1[k], center + offs.row_lin2[k]);
+			}
+			votes += k2 - k1;
+		}
+		else {
+			int plane = z * strides.z;
+			for (int k = k1; k < k2; k++) {
+				hough_x = x + offs.dx[k];
+				hough_y = y + offs.dy[k];
+
+				if (hough_x >= 0 && hough_x < acc_w && hough_y >= 0 && hough_y < acc_h) {
+					acc_vote(acc[plane + hough_x * strides.x + hough_y * strides.y]);
+					votes++;
+				}
+			}
+			for (int k = offs.row_start[z]; k < offs.row_start[z + 1]; k++) {
+				hough_y = y + offs.row_dy[k];
+				int hough_x1 = max(0, x + offs.row_dx1[k]);
+				int hough_x2 = min(acc_w - 1, x + offs.row_dx2[k]);
+				if (hough_y >= 0 && hough_y < acc_h && hough_x1 <= hough_x2) {
+					mark_occupied(occ_map, plane + hough_x1 * strides.x + hough_y * strides.y, plane + hough_x2 * strides.x + hough_y * strides.y);
+				}
+			}
+		}
+	}
+	return votes;
+}
+
+/*!
+ * \brief Cache-blocked voting. Edge pixels are bucketed into square tiles, so the accumulator
+		  window written by one tile (tile + 2 * max_radius) stays cache-resident.
+		  For planar layout, each tile is voted radius by radius (one plane window at a time),
+		  for radius-inner layout, all radii of a pixel are voted together.
+		  In parallel, tiles are processed in 4 phases (checkerboard by tile parity) and tiles are
+		  at least 2 * max_radius wide, so concurrently voted windows never overlap (no data races).
+ * \tparam T Accumulator counter type
+ * \param acc Accumulator 1D-array
+ * \param occ_map Occupancy map (see vote_pixel)
+ * \param strides Accumulator strides
+ * \param offs Voting offsets
+ * \param edge_pts Edge pixel coordinates (image coordinates)
+ * \param x_shift X-shift from image to accumulator coordinates
+ * \param y_shift Y-shift from image to accumulator coordinates
+ * \param min_radius Minimum circle radius
+ * \param max_radius Maximum circle radius
+ * \param acc_w Accumulator width
+ * \param acc_h Accumulator height
+ * \param acc_layout Accumulator memory layout
+ * \param tile_size Tile edge length in pixels
+ * \param parallel Parallelize over tiles with OpenMP
+ * \param omp_threads Number of OpenMP threads
+ * \param run Metrics to add the hardware counters of every thread to
+ * \return Number of votes cast
+ */
+template <typename T>
+long long hough::vote_tiled(T* acc, uchar* occ_map, const acc_strides& strides, const acc_offsets& offs,
+	const vector<Point>& edge_pts, const int& x_shift, const int& y_shift, const int& min_radius, const int& max_radius,
+	const int& acc_w, const int& acc_h, const AccLayout& acc_layout, const int& tile_size,
+	const bool& parallel, const int& omp_threads, run_metrics& run) {
+
+	int tile = parallel ? max(tile_size, 2 * max_radius) : tile_size;
+	int tiles_x = (acc_w + tile - 1) / tile;
+	int tiles_y = (acc_h + tile - 1) / tile;
+	int tiles_cnt = tiles_x * tiles_y;
+
+	//bucket edge pixels by tile (counting sort), pixels keep their row-major order inside a tile
+	long long votes = 0;
+	vector<int> tile_start(tiles_cnt + 1, 0);
+	vector<Point> tile_pts(edge_pts.size());
+
+	for (size_t k = 0; k < edge_pts.size(); k++) {
+		int tile_ind = (((edge_pts[k].y + y_shift) / tile) * tiles_x) + ((edge_pts[k].x + x_shift) / tile);
+		tile_start[tile_ind + 1]++;
+	}
+	for (int k = 0; k < tiles_cnt; k++) {
+		tile_start[k + 1] += tile_start[k];
+	}
+	vector<int> tile_fill(tile_start.begin(), tile_start.end() - 1);
+	for (size_t k = 0; k < edge_pts.size(); k++) {
+		int tile_ind = (((edge_pts[k].y + y_shift) / tile) * tiles_x) + ((edge_pts[k].x + x_shift) / tile);
+		tile_pts[tile_fill[tile_ind]++] = Point(edge_pts[k].x + x_shift, edge_pts[k].y + y_shift);
+	}
+
+	//hardware counters of every thread, added to the run after the parallel region
+	vector<perf_sample> thread_perf(omp_threads, perf_sample{ -1, -1, -1, -1 });
+
+	#pragma omp parallel num_threads(omp_threads) reduction(+:votes) if(parallel)
+	{
+		//hardware counters and trace span (if enabled) cover all phases of a thread
+		long long thread_start = metrics::now();
+		perf_group perf = perfctr::start();
+
+		//4 phases: tiles with equal X and Y parity never share accumulator bins
+		//(the implicit barrier at the end of each phase keeps phases apart)
+		for (int phase = 0; phase < 4; phase++) {
+
+			#pragma omp for collapse(2) schedule(dynamic)
+			for (int ty = (phase >> 1); ty < tiles_y; ty += 2) {
+				for (int tx = (phase & 1); tx < tiles_x; tx += 2) {
+
+					int tile_ind = ty * tiles_x + tx;
+
+					if (acc_layout == AccLayout::planar) {
+						for (int r = min_radius; r <= max_radius; r++) {
+							for (int k = tile_start[tile_ind]; k < tile_start[tile_ind + 1]; k++) {
+								votes += vote_pixel(acc, occ_map, strides, offs, tile_pts[k].x, tile_pts[k].y, r, r, min_radius, acc_w, acc_h);
+							}
+						}
+					}
+					else {
+						for (int k = tile_start[tile_ind]; k < tile_start[tile_ind + 1]; k++) {
+							votes += vote_pixel(acc, occ_map, strides, offs, tile_pts[k].x, tile_pts[k].y, min_radius, max_radius, min_radius, acc_w, acc_h);
+						}
+					}
+				}
+			}
+		}
+
+		thread_perf[omp_get_thread_num()] = perfctr::stop(perf);
+		trace::add("voting_thread", thread_start, metrics::now());
+	}
+
+	for (int t = 0; t < omp_threads; t++) {
+		metrics::add_perf(run, "voting", t, thread_perf[t]);
+	}
+	return votes;
+}
+
+/*!
+ * \brief Checks whether any accumulator bin of a region (all radii) reaches its per-radius vote treshold.
+		  For radius-inner layout, radii are interleaved, so the smallest treshold is used (never misses a peak).
+		  Runs lying in unoccupied blocks only (no votes at all) are skipped without reading the accumulator.
+ * \tparam T Accumulator counter type
+ * \param acc Accumulator 1D-array
+ * \param occ Occupancy bitmap (empty = unknown, every run is scanned)
+ * \param strides Accumulator strides
+ * \param x1 Start X-index
+ * \param x2 End X-index (exclusive)
+ * \param y1 Start Y-index
+ * \param y2 End Y-index (exclusive)
+ * \param vote_tresh Vote treshold per accumulator Z-index
+ * \param simd_type SIMD type to run
+ */
+template <typename T>
+bool hough::region_has_peak(const T* acc, const vector<unsigned long long>& occ, const acc_strides& strides, const int& x1, const int& x2, const int& y1, const int& y2,
+	const vector<long long>& vote_tresh, const SimdType& simd_type) {
+
+	int acc_d = (int)vote_tresh.size();
+	long long min_tresh = *min_element(vote_tresh.begin(), vote_tresh.end());
+
+	for (int y = y1; y < y2; y++) {
+		if (strides.z == 1) {
+			//radius-inner, all radii of the row are one contiguous run
+			int run = y * strides.y + x1 * strides.x;
+			if (!occ_any(occ, run, (x2 - x1) * acc_d)) {
+				continue;
+			}
+			if (simd::any_ge(acc + run, (x2 - x1) * acc_d, (int)min(min_tresh, (long long)numeric_limits<int>::max()), simd_type)) {
+				return true;
+			}
+		}
+		else {
+			for (int z = 0; z < acc_d; z++) {
+				int run = y * strides.y + z * strides.z + x1;
+				if (!occ_any(occ, run, x2 - x1)) {
+					continue;
+				}
+				if (simd::any_ge(acc + run, x2 - x1, (int)min(vote_tresh[z], (long long)numeric_limits<int>::max()), simd_type)) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+/*!
+ * \brief Computes per-radius peak scoring factors, normalizing votes by stencil size.
+		  Scores are per-mille of the radius' stencil (Q16 fixed-point factors), so a single
+		  peak treshold means the same circle coverage for every radius.
+		  Without normalization, the list stays empty and scores equal votes.
+ * \param norm_scale Output Q16 scoring factor per accumulator Z-index
+ * \param offs Voting offsets
+ * \param use_normalize Normalization on/off
+ */
+void hough::fill_norm_scale(vector<long long>& norm_scale, const acc_offsets& offs, const bool& use_normalize) {
+	norm_scale.clear();
+	if (!use_normalize) {
+		return;
+	}
+	for (size_t z = 0; z + 1 < offs.start.size(); z++) {
+		long long cnt = max(1, offs.start[z + 1] - offs.start[z]);
+		norm_scale.push_back(((norm_ref << 16) + (cnt / 2)) / cnt);
+	}
+}
+
+/*!
+ * \brief Computes the peak score of an accumulator value.
+ * \param votes Accumulator value
+ * \param z Accumulator Z-index
+ * \param norm_scale Q16 scoring factor per accumulator Z-index (empty = no normalization)
+ * \return Peak score (rounded)
+ */
+inline long long hough::acc_score(const long long& votes, const int& z, const vector<long long>& norm_scale) {
+	if (norm_scale.empty()) {
+		return votes;
+	}
+	return ((votes * norm_scale[z]) + (1 << 15)) >> 16;
+}
+
+/*!
+ * \brief Converts the peak score treshold into the smallest accumulator value reaching it, per radius.
+		  Scores grow monotonically with votes, so comparing votes against these tresholds
+		  is exactly equivalent to comparing scores against the peak treshold.
+ * \param vote_tresh Output vote treshold per accumulator Z-index
+ * \param peak_tresh Peak score treshold
+ * \param acc_d Accumulator depth
+ * \param norm_scale Q16 scoring factor per accumulator Z-index (empty = no normalization)
+ */
+void hough::fill_vote_tresh(vector<long long>& vote_tresh, const int& peak_tresh, const int& acc_d, const vector<long long>& norm_scale) {
+	vote_tresh.assign(acc_d, max(0, peak_tresh));
+	if (norm_scale.empty() || peak_tresh <= 0) {
+		return;
+	}
+	for (int z = 0; z < acc_d; z++) {
+		long long v = max(0LL, (((long long)peak_tresh << 16) / norm_scale[z]) - 2);
+		while (acc_score(v, z, norm_scale) < peak_tresh) {
+			v++;
+		}
+		vote_tresh[z] = v;
+	}
+}
+
+/*!
+ * \brief Computes the vertex offset of a parabola through three equally spaced samples.
+ * \param lo Sample at offset -1
+ * \param mid Sample at offset 0 (peak)
+ * \param hi Sample at offset +1
+ * \return Vertex offset, clamped to [-0.5, 0.5] (0 if the samples are not concave)
+ */
+double hough::parabola_offset(const double& lo, const double& mid, const double& hi) {
+	double curv = lo - 2 * mid + hi;
+	if (curv >= 0) {
+		return 0.0;
+	}
+	return max(-0.5, min(0.5, (lo - hi) / (2 * curv)));
+}
+
+/*!
+ * \brief Refines an accumulator peak to a subpixel center and radius by fitting a quadratic to the
+		  peak scores of its 3x3x3 neighborhood (newton step on central differences).
+		  Falls back to one parabola per axis if the neighborhood is clipped or the fit is no maximum within half a bin.
+ * \tparam T Accumulator counter type
+ * \param acc Accumulator
+ * \param strides Accumulator strides
+ * \param x Peak X-index
+ * \param y Peak Y-index
+ * \param z Peak Z-index
+ * \param x1 Start X-index of the valid region
+ * \param x2 End X-index of the valid region (exclusive)
+ * \param y1 Start Y-index of the valid region
+ * \param y2 End Y-index of the valid region (exclusive)
+ * \param acc_d Accumulator depth (radius count)
+ * \param norm_scale Q16 scoring factor per accumulator Z-index (empty = no normalization)
+ * \param off Output offsets of the refined peak: x, y, z (each within [-0.5, 0.5])
+ */
+template <typename T>
+void hough::refine_peak(const T* acc, const acc_strides& strides, const int& x, const int& y, const int& z,
+	const int& x1, const int& x2, const int& y1, const int& y2, const int& acc_d, const vector<long long>& norm_scale, double* off) {
+
+	double nb[3][3][3]; //peak scores around the peak, [dz][dy][dx]; -1 outside the valid region
+	bool clipped = false;
+	int ind;
+
+	for (int k = 0; k < 3; k++) {
+		for (int j = 0; j < 3; j++) {
+			for (int i = 0; i < 3; i++) {
+				int xi = x + i - 1;
+				int yj = y + j - 1;
+				int zk = z + k - 1;
+				if (xi < x1 || xi >= x2 || yj < y1 || yj >= y2 || zk < 0 || zk >= acc_d) {
+					nb[k][j][i] = -1;
+					clipped = true;
+					continue;
+				}
+				//unrounded score, so the fit sees the same shape as the normalized peak search
+				ind_3d_to_1d(ind, xi, yj, zk, strides);
+				nb[k][j][i] = norm_scale.empty() ? (double)acc[ind] : acc[ind] * (norm_scale[zk] / 65536.0);
+			}
+		}
+	}
+
+	double c = nb[1][1][1];
+
+	if (!clipped) {
+		//gradient and hessian by central differences
+		double gx = (nb[1][1][2] - nb[1][1][0]) / 2;
+		double gy = (nb[1][2][1] - nb[1][0][1]) / 2;
+		double gz = (nb[2][1][1] - nb[0][1][1]) / 2;
+		double hxx = nb[1][1][2] - 2 * c + nb[1][1][0];
+		double hyy = nb[1][2][1] - 2 * c + nb[1][0][1];
+		double hzz = nb[2][1][1] - 2 * c + nb[0][1][1];
+		double hxy = (nb[1][2][2] - nb[1][2][0] - nb[1][0][2] + nb[1][0][0]) / 4;
+		double hxz = (nb[2][1][2] - nb[2][1][0] - nb[0][1][2] + nb[0][1][0]) / 4;
+		double hyz = (nb[2][2][1] - nb[2][0][1] - nb[0][2][1] + nb[0][0][1]) / 4;
+
+		//cofactors of the (symmetric) hessian
+		double cxx = hyy * hzz - hyz * hyz;
+		double cxy = hxz * hyz - hxy * hzz;
+		double cxz = hxy * hyz - hxz * hyy;
+		double cyy = hxx * hzz - hxz * hxz;
+		double cyz = hxy * hxz - hxx * hyz;
+		double czz = hxx * hyy - hxy * hxy;
+		double det = hxx * cxx + hxy * cxy + hxz * cxz;
+
+		//maximum only if the hessian is negative definite
+		if (hxx < 0 && czz > 0 && det < 0) {
+			double dx = -(cxx * gx + cxy * gy + cxz * gz) / det;
+			double dy = -(cxy * gx + cyy * gy + cyz * gz) / det;
+			double dz = -(cxz * gx + cyz * gy + czz * gz) / det;
+			if (fabs(dx) <= 0.5 && fabs(dy) <= 0.5 && fabs(dz) <= 0.5) {
+				off[0] = dx;
+				off[1] = dy;
+				off[2] = dz;
+				return;
+			}
+		}
+	}
+
+	//fallback: one parabola per axis, axes with a clipped neighbour stay on the bin
+	off[0] = (nb[1][1][0] < 0 || nb[1][1][2] < 0) ? 0.0 : parabola_offset(nb[1][1][0], c, nb[1][1][2]);
+	off[1] = (nb[1][0][1] < 0 || nb[1][2][1] < 0) ? 0.0 : parabola_offset(nb[1][0][1], c, nb[1][2][1]);
+	off[2] = (nb[0][1][1] < 0 || nb[2][1][1] < 0) ? 0.0 : parabola_offset(nb[0][1][1], c, nb[2][1][1]);
+}
+
+/*!
+ * \brief Counts all edge pixels (255 = white) of an edge image.
+ * \param img Edge image
+ * \return Number of edge pixels
+ */
+int hough::count_edges(const Mat& img) {
+	int cnt = 0;
+	for (int i = 0; i < img.rows; ++i) {
+		const uchar* row = img.ptr<uchar>(i);
+		for (int j = 0; j < img.cols; ++j) {
+			cnt += (row[j] == 255);
+		}
+	}
+	return cnt;
+}
+
+/*!
+ * \brief Computes an upper bound on the number of votes a single accumulator bin can receive.
+		  Every stencil entry maps a bin to exactly one source pixel, so a bin never gets more votes than
+		  the largest per-radius stencil has entries. A single edge pixel votes a bin once per duplicate of
+		  the offset leading to it (angle stencils repeat offsets, midpoint stencils do not), so a bin also
+		  never gets more than edge pixels times the largest offset multiplicity.
+		  Holds for all implementation types, including merged MPI accumulators.
+		  Both stencil maxima are computed once with the voting offsets (see \link hough::fill_acc_offsets \endlink).
+ * \param edge_cnt Number of edge pixels
+ * \param offs Voting offsets
+ * \return Maximum number of votes per accumulator bin
+ */
+long long hough::votes_per_bin_bound(const int& edge_cnt, const acc_offsets& offs) {
+	return min((long long)edge_cnt * offs.mult_max, (long long)offs.stencil_max);
+}
+
+/*!
+ * \brief Picks the smallest accumulator counter type that cannot overflow.
+ * \param votes_bound Upper bound on votes per accumulator bin
+ * \return Accumulator counter type
+ */
+AccType hough::select_acc_type(const long long& votes_bound) {
+	if (votes_bound <= numeric_limits<uchar>::max()) {
+		return AccType::acc_u8;
+	}
+	if (votes_bound <= numeric_limits<ushort>::max()) {
+		return AccType::acc_u16;
+	}
+	return AccType::acc_u32;
+}
+
+/*!
+ * \brief Returns the MPI datatype matching an accumulator counter type.
+ * \tparam T Accumulator counter type
+ */
+template <>
+MPI_Datatype hough::acc_mpi_type<uchar>() {
+	return MPI_UNSIGNED_CHAR;
+}
+
+template <>
+MPI_Datatype hough::acc_mpi_type<ushort>() {
+	return MPI_UNSIGNED_SHORT;
+}
+
+template <>
+MPI_Datatype hough::acc_mpi_type<uint>() {
+	return MPI_UNSIGNED;
+}
+
+/*!
+ * \brief Creates a committed MPI subarray datatype describing a region (all radii) of an accumulator,
+		  so a cropped accumulator can be received straight into its shifted region. Free with MPI_Type_free.
+		  A row stripe (full width) is contiguous per radius plane (planar) or as a whole (radius-inner).
+ * \param acc_w Accumulator width
+ * \param acc_h Accumulator height
+ * \param acc_d Accumulator depth (radius count)
+ * \param region Region in accumulator X/Y-coordinates
+ * \param acc_layout Accumulator memory layout
+ * \param elem_type MPI datatype of a single bin
+ */
+MPI_Datatype hough::acc_region_type(const int& acc_w, const int& acc_h, const int& acc_d, const Rect& region,
+	const AccLayout& acc_layout, const MPI_Datatype& elem_type) {
+
+	//dimensions in C order, slowest first
+	int sizes[3], subsizes[3], starts[3];
+	if (acc_layout == AccLayout::radius_inner) {
+		sizes[0] = acc_h; sizes[1] = acc_w; sizes[2] = acc_d;
+		subsizes[0] = region.height; subsizes[1] = region.width; subsizes[2] = acc_d;
+		starts[0] = region.y; starts[1] = region.x; starts[2] = 0;
+	}
+	else {
+		sizes[0] = acc_d; sizes[1] = acc_h; sizes[2] = acc_w;
+		subsizes[0] = acc_d; subsizes[1] = region.height; subsizes[2] = region.width;
+		starts[0] = 0; starts[1] = region.y; starts[2] = region.x;
+	}
+
+	MPI_Datatype region_type;
+	MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, elem_type, &region_type);
+	MPI_Type_commit(&region_type);
+	return region_type;
+}
+
+/*!
+ * \brief Computes the FNV-1a hash of an accumulator region (all radii), bin values as 32-bit integers.
+ * \tparam T Accumulator counter type
+ * \param acc Accumulator
+ * \param strides Accumulator strides
+ * \param x1 Start X-index
+ * \param x2 End X-index (exclusive)
+ * \param y1 Start Y-index
+ * \param y2 End Y-index (exclusive)
+ * \param acc_d Accumulator depth (radius count)
+ */
+template <typename T>
+long long hough::acc_hash(const T* acc, const acc_strides& strides, const int& x1, const int& x2, const int& y1, const int& y2, const int& acc_d) {
+	unsigned long long hash = 14695981039346656037ULL;
+	int ind;
+
+	for (int r = 0; r < acc_d; r++) {
+		for (int y = y1; y < y2; y++) {
+			for (int x = x1; x < x2; x++) {
+				ind_3d_to_1d(ind, x, y, r, strides);
+				unsigned int v = acc[ind];
+				for (int b = 0; b < 4; b++) {
+					hash = (hash ^ ((v >> (8 * b)) & 0xFF)) * 1099511628211ULL;
+				}
+			}
+		}
+	}
+	return (long long)hash;
+}
+
+/*!
+ * \brief Creates a committed MPI indexed datatype describing runs of accumulator bins,
+		  so only occupied runs are sent and received (no packing). Free with MPI_Type_free.
+ * \param run_starts Run start indices (bins)
+ * \param run_lens Run lengths (bins)
+ * \param elem_type MPI datatype of a single bin
+ */
+MPI_Datatype hough::acc_runs_type(vector<int>& run_starts, vector<int>& run_lens, const MPI_Datatype& elem_type) {
+	MPI_Datatype runs_type;
+	MPI_Type_indexed((int)run_starts.size(), run_lens.data(), run_starts.data(), elem_type, &runs_type);
+	MPI_Type_commit(&runs_type);
+	return runs_type;
+}
+
+/*!
+ * \brief Copies a band (region, all radii) of an accumulator into a band buffer (save), or adds the band buffer
+		  back onto the accumulator (restore). The band is walked in contiguous runs (one row of a radius plane for
+		  planar layout, one row over all radii for radius-inner layout), rows in parallel.
+ * \tparam T Accumulator counter type
+ * \param acc Accumulator
+ * \param strides Accumulator strides
+ * \param band Band buffer
+ * \param band_strides Band buffer strides
+ * \param region Band region in accumulator X/Y-coordinates
+ * \param acc_d Accumulator depth (radius count)
+ * \param restore False to save the band, true to add it back
+ * \param simd_type SIMD type to run
+ * \param omp_threads Number of OpenMP threads
+ */
+template <typename T>
+void hough::acc_band(T* acc, const acc_strides& strides, T* band, const acc_strides& band_strides,
+	const Rect& region, const int& acc_d, const bool& restore, const SimdType& simd_type, const int& omp_threads) {
+
+	//radius-inner: one run per row covers all radii
+	bool radius_inner = (strides.z == 1);
+	int planes = radius_inner ? 1 : acc_d;
+	int run_len = radius_inner ? region.width * acc_d : region.width;
+
+	#pragma omp parallel for collapse(2) num_threads(omp_threads) schedule(static)
+	for (int r = 0; r < planes; r++) {
+		for (int y = 0; y < region.height; y++) {
+			int ind, ind_band;
+			ind_3d_to_1d(ind, region.x, region.y + y, r, strides);
+			ind_3d_to_1d(ind_band, 0, y, r, band_strides);
+			if (restore) {
+				simd::add_sat(acc + ind, band + ind_band, run_len, simd_type);
+			}
+			else {
+				memcpy(band + ind_band, acc + ind, (size_t)run_len * sizeof(T));
+			}
+		}
+	}
+}
+
+/*!
+ * \brief Packs the occupancy map filled while voting (one byte per block) into an occupancy bitmap
+		  (one bit per block, 64 blocks per word).
+ * \param occ_map Occupancy map
+ * \param acc_size Accumulator total size
+ * \param occ Output bitmap
+ * \param omp_threads Number of OpenMP threads
+ */
+void hough::occ_pack(const uchar* occ_map, const int& acc_size, vector<unsigned long long>& occ, const int& omp_threads) {
+	int blocks = (acc_size + occ_block - 1) / occ_block;
+	int words = (blocks + 63) / 64;
+	occ.assign(words, 0);
+
+	#pragma omp parallel for num_threads(omp_threads) schedule(static)
+	for (int w = 0; w < words; w++) {
+		unsigned long long bits = 0;
+		for (int b = 0; b < 64 && w * 64 + b < blocks; b++) {
+			bits |= (unsigned long long)(occ_map[w * 64 + b] != 0) << b;
+		}
+		occ[w] = bits;
+	}
+}
+
+/*!
+ * \brief Checks whether any block touched by a run of accumulator bins is occupied.
+ * \param occ Occupancy bitmap (empty = unknown, always true)
+ * \param start Run start index (bins)
+ * \param len Run length (bins)
+ */
+inline bool hough::occ_any(const vector<unsigned long long>& occ, const int& start, const int& len) {
+	if (occ.empty()) {
+		return true;
+	}
+	if (len <= 0) {
+		return false;
+	}
+
+	int b1 = start / occ_block;
+	int b2 = (start + len - 1) / occ_block;
+	int w1 = b1 / 64, w2 = b2 / 64;
+
+	//mask off the blocks before b1 in the first word and after b2 in the last word
+	unsigned long long first = ~0ULL << (b1 % 64);
+	unsigned long long last = ~0ULL >> (63 - (b2 % 64));
+	if (w1 == w2) {
+		return (occ[w1] & first & last) != 0;
+	}
+	if ((occ[w1] & first) != 0 || (occ[w2] & last) != 0) {
+		return true;
+	}
+	for (int w = w1 + 1; w < w2; w++) {
+		if (occ[w] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*!
+ * \brief Converts an occupancy bitmap into runs of occupied bins. Runs never cross a bitmap word,
+		  so no run is longer than 64 blocks (keeps parallel merges balanced).
+ * \param occ Occupancy bitmap
+ * \param acc_size Accumulator total size
+ * \param run_starts Output run start indices (bins)
+ * \param run_lens Output run lengths (bins)
+ */
+void hough::occ_runs(const vector<unsigned long long>& occ, const int& acc_size, vector<int>& run_starts, vector<int>& run_lens) {
+	run_starts.clear();
+	run_lens.clear();
+
+	for (int w = 0; w < (int)occ.size(); w++) {
+		unsigned long long bits = occ[w];
+		while (bits != 0) {
+			int b1 = __builtin_ctzll(bits);
+			int b2 = b1;
+			while (b2 < 64 && (bits >> b2) & 1ULL) {
+				b2++;
+			}
+			int start = (w * 64 + b1) * occ_block;
+			run_starts.push_back(start);
+			run_lens.push_back(min((b2 - b1) * occ_block, acc_size - start));
+			bits &= (b2 == 64) ? 0ULL : ~0ULL << b2;
+		}
+	}
+}
+
+/*!
+ * \brief Marks the occupied blocks of a cropped accumulator (mpi crop/rows worker) in the occupancy bitmap of the
+		  total accumulator. Occupied runs are split into rows (one Y of a radius plane for planar layout, one Y over
+		  all radii for radius-inner layout), which stay contiguous in the total accumulator; every total block
+		  such a row touches, even partly, is marked occupied.
+ * \param occ Occupancy bitmap of the cropped accumulator
+ * \param crop_size Cropped accumulator total size
+ * \param crop_strides Cropped accumulator strides
+ * \param crop_h Cropped accumulator height
+ * \param region Cropped accumulator region in total accumulator X/Y-coordinates
+ * \param strides Total accumulator strides
+ * \param occ_total Occupancy bitmap of the total accumulator (bits are only set)
+ */
+void hough::occ_shift(const vector<unsigned long long>& occ, const int& crop_size, const acc_strides& crop_strides, const int& crop_h,
+	const Rect& region, const acc_strides& strides, vector<unsigned long long>& occ_total) {
+
+	bool radius_inner = (crop_strides.z == 1);
+	int row_len = crop_strides.y;
+	vector<int> run_starts, run_lens;
+	occ_runs(occ, crop_size, run_starts, run_lens);
+
+	for (size_t k = 0; k < run_starts.size(); k++) {
+		int run_end = run_starts[k] + run_lens[k];
+		for (int ind1 = run_starts[k]; ind1 < run_end;) {
+			int row = ind1 / row_len;
+			int ind2 = min(run_end, (row + 1) * row_len);
+
+			//row start in the total accumulator
+			int ind;
+			ind_3d_to_1d(ind, region.x, region.y + (radius_inner ? row : row % crop_h), radius_inner ? 0 : row / crop_h, strides);
+
+			int b1 = (ind + ind1 - row * row_len) / occ_block;
+			int b2 = (ind + ind2 - 1 - row * row_len) / occ_block;
+			for (int b = b1; b <= b2; b++) {
+				occ_total[b / 64] |= 1ULL << (b % 64);
+			}
+			ind1 = ind2;
+		}
+	}
+}
+
+/*!
+ * \brief Adds all occupied runs of a received accumulator onto the total accumulator (saturating), runs in parallel.
+ * \tparam T Accumulator counter type
+ * \param dst Total accumulator
+ * \param src Received accumulator
+ * \param run_starts Run start indices (bins)
+ * \param run_lens Run lengths (bins)
+ * \param simd_type SIMD type to run
+ * \param omp_threads Number of OpenMP threads
+ */
+template <typename T>
+void hough::acc_merge(T* dst, const T* src, const vector<int>& run_starts, const vector<int>& run_lens,
+	const SimdType& simd_type, const int& omp_threads) {
+
+	#pragma omp parallel for num_threads(omp_threads) schedule(dynamic, 16)
+	for (int k = 0; k < (int)run_starts.size(); k++) {
+		simd::add_sat(dst + run_starts[k], src + run_starts[k], run_lens[k], simd_type);
+	}
+}
+
+/*!
+ * \brief Adds a single vote to an accumulator bin.
+ * \tparam T Accumulator counter type
+ * \param bin Accumulator bin
+ */
+template <typename T>
+inline void hough::acc_vote(T& bin) {
+	bin++;
+}
+
+/*!
+ * \brief Adds a single vote to an 8-bit accumulator bin, saturating at 255 instead of wrapping.
+ * \param bin Accumulator bin
+ */
+template <>
+inline void hough::acc_vote<uchar>(uchar& bin) {
+	bin += (bin != numeric_limits<uchar>::max());
+}
+
+/*!
+ * \brief Adds votes of one accumulator bin to another, saturating at the maximum counter value.
+ * \tparam T Accumulator counter type
+ * \param dst Destination accumulator bin
+ * \param val Votes to add
+ */
+template <typename T>
+inline void hough::acc_add(T& dst, const T& val) {
+	dst = (dst > numeric_limits<T>::max() - val) ? numeric_limits<T>::max() : dst + val;
+}
+
+/*!
+ * \brief Returns a zeroed array inside a reusable byte buffer, growing the buffer if it is too small.
+		  A grown buffer is reallocated to the exact size (its old contents are not needed) and the growth is accounted;
+		  the bytes stay accounted while the buffer is kept (see \link hough::free_buffers \endlink).
+ * \tparam T Element type
+ * \param buf Byte buffer
+ * \param size Number of elements
+ * \param mem Buffer accounting of the detector owning the buffer
+ * \param name Buffer class
+ * \return Array of size elements (valid until the buffer grows again)
+ */
+template <typename T>
+T* hough::take_buffer(vector<uchar>& buf, const long long& size, mem_account& mem, const string& name) {
+	size_t bytes = (size_t)size * sizeof(T);
+	if (buf.size() < bytes) {
+		memtrack::alloc(mem, name, (long long)(bytes - buf.size()));
+		vector<uchar>(bytes).swap(buf);
+	}
+	memset(buf.data(), 0, bytes);
+	return reinterpret_cast<T*>(buf.data());
+}
+
+/*!
+ * \brief Frees the accumulator and image buffers of a detector and drops their accounted bytes
+		  (voting offsets and edge pixels are kept).
+ * \param bufs Working buffers
+ * \param mem Buffer accounting of the detector owning bufs
+ */
+void hough::free_buffers(hough_buffers& bufs, mem_account& mem) {
+	memtrack::release(mem, "acc", (long long)(bufs.acc.size() + bufs.occ_map.size()));
+	memtrack::release(mem, "rbuf", (long long)bufs.acc_rbuf.size());
+	memtrack::release(mem, "crop", (long long)bufs.acc_band.size());
+	memtrack::release(mem, "src", (long long)bufs.src_rbuf.size());
+	vector<uchar>().swap(bufs.acc);
+	vector<uchar>().swap(bufs.acc_rbuf);
+	vector<uchar>().swap(bufs.acc_band);
+	vector<uchar>().swap(bufs.occ_map);
+	vector<uchar>().swap(bufs.src_rbuf);
+}
+
 /*!
  * \brief Performs a circle hough transformation on an edge image with different parallelization techniques.
 		  Records execution times of main hough transform algorithm.
-		  Applies linear binning and euclidean spacing to filter found circles.
-		  Counts all circles. Outputs image with drawn circles.
+		  Applies linear binning and euclidean spacing to filter found circles, refines them to subpixel.
+		  Draws and prints nothing; working buffers are taken from (and left in) bufs.
 		  <A HREF=hough_8c_source.html><B> main.c annotated source </B></A>
  * \param imp_type Implementation type (sequentail, omp, mpi)
  * \param mpi_type MPI field size to send and receive
  * \param img Edge image
- * \param src_img Original colored image
  * \param min_radius Minimum circle radius
  * \param max_radius Maximum circle radius
  * \param peak_tresh Accumulator peak treshold
@@ -75,12 +1081,23 @@ void hough::ind_1d_to_3d(int ind, int& x, int& y, int& z, const int& width, cons
  * \param world_size Number of all MPI processes
  * \param world_rank Process ID of an MPI process
  * \param omp_threads Number of OpenMP threads
+ * \param tile_size Tile edge length for cache-blocked voting (0 = off, -1 = fit to L2 cache)
+ * \param acc_layout Accumulator memory layout
+ * \param simd_type SIMD type of vectorized kernels (simd_auto picks the widest available)
+ * \param offs Voting offsets (X/Y-offsets of the stencil)
+ * \param use_normalize Radius-normalized peak scoring on/off (peak_tresh is then per-mille of the stencil size)
+ * \param bufs Working buffers (reused between transformations, bufs.edge_pts holds the edge pixels of the whole image, except on mpi workers)
+ * \param result Output found circles and execution times
+ * \param time_start_total Start of the transformation (total runtime includes the edge compaction in \link hough::detect \endlink)
+ * \param run Metrics to record stages and counters into
+ * \param mem Buffer accounting of the calling detector
+ * \tparam T Accumulator counter type
  */
-Mat hough::circle(
+template <typename T>
+void hough::circle_acc(
 	ImpType imp_type,
 	MpiType mpi_type,
 	Mat& img,
-	Mat& src_img,
 	const int& min_radius,
 	const int& max_radius,
 	const int& peak_tresh,
@@ -90,12 +1107,23 @@ Mat hough::circle(
 	const int& spacing_size,
 	const int& world_size,
 	const int& world_rank,
-	const int& omp_threads) {
+	const int& omp_threads,
+	const int& tile_size,
+	const AccLayout& acc_layout,
+	const SimdType& simd_type,
+	acc_offsets& offs,
+	const bool& use_normalize,
+	hough_buffers& bufs,
+	hough_result& result,
+	const std::chrono::time_point<std::chrono::high_resolution_clock>& time_start_total,
+	run_metrics& run,
+	mem_account& mem) {
 
 #pragma region variable declaration
 
-	vector<tuple<int, int, int, bool>> circles; //list of found circles; tuple: x,y,r,drawn
-	int circles_found_cnt = 0; //number of circles found
+	vector<tuple<int, int, int, bool, long long>> circles; //list of found circles; tuple: x,y,r,drawn,score
+	vector<tuple<double, double, double>> circles_subpx; //subpixel refinement of found circles; tuple: x,y,r
+	double subpx_off[3]; //refined peak offsets: x,y,r
 
 	//accumulator-related
 
@@ -104,11 +1132,12 @@ Mat hough::circle(
 	int acc_d = (max_radius - min_radius + 1); //accumulator depth (z)
 	int acc_size = acc_w * acc_h * acc_d; //accumulator total size
 
-	ushort* acc; //accumulator 1d-array
-	ushort* acc_rbuf; //accumulator receive buffer, 1d-array
-	vector<ushort*> accs; //list of accumulators
-	vector<tuple<int, int>> accs_sizes; //list of accumulator sizes; tuple: width,total_size
-	int accs_cur_w = 0; //current width of accumulator while merging received mpi accumulators
+	T* acc = nullptr; //accumulator 1d-array
+	T* acc_rbuf = nullptr; //accumulator receive buffer, 1d-array
+	T* acc_band_buf = nullptr; //overlap band of neighbouring cropped accumulators (mpi crop/rows, root), 1d-array
+	int acc_band_w = 0, acc_band_h = 0; //overlap band width, height
+	int acc_band_size = 0; //overlap band total size
+	vector<Rect> acc_rois; //list of cropped accumulator regions in total accumulator coordinates (mpi crop/rows)
 
 	//image-related
 
@@ -118,47 +1147,54 @@ Mat hough::circle(
 	int src_w = img.cols; //image width
 	int src_h = img.rows; //image height
 	int src_size = src_w * src_h; //total image size
-	uchar* src; //image 1d-array
+	int src_step = (int)img.step; //image row stride in bytes
+	uchar* src = img.data; //image rows, pointing into the edge image itself (no copy)
+	uchar* src_rbuf = nullptr; //image receive buffer (mpi non-root), 1d-array
 
-	vector<uchar*> src_rois; //list of image ROIs
-	vector<tuple<int, int, int>> src_roi_sizes; //list of image ROI sizes; tuple: x,w,size
-	int src_roi_shiftsize = 0; //size of ROI shift in X-direction
+	vector<Rect> src_rois; //list of image ROIs
+	int src_roi_shiftsize = 0; //size of ROI shift in X-direction (mpi full, crop) or Y-direction (mpi rows)
 
 	//index conversion variables
 
 	int ind = 0; //1d-index in 2d-image
-	int ind_acc = 0; //1d-index in 3d-accumulator
-	int ind_x = 0, ind_y = 0, ind_z = 0; //3d-indices in 1d-array
-
-	/*
-	to_1d(ind, 1, 2, 3, acc_w, acc_h);
-	cout << "to_1d: " << ind << endl;
 
-	to_3d(ind, ind_x, ind_y, ind_z, acc_w, acc_h);
-	cout << "to_3d: " << ind_x << " " << ind_y << " " << ind_z << " " << endl;
-	*/
-
-	//for mpi crop, shifting X-positions for proper accumulator coords in hough transform algorithm
+	//for mpi crop/rows, shifting X/Y-positions for proper accumulator coords in hough transform algorithm
 	int mpi_x_shift = (imp_type == ImpType::openmpi && mpi_type == MpiType::crop) ? max_radius : 0;
+	int mpi_y_shift = (imp_type == ImpType::openmpi && mpi_type == MpiType::rows) ? max_radius : 0;
 
 	//flag to indicate whether there is enough space between each circle
 	bool inbetween_ok;
 	//max accumulator values found while binning
 	double bin_max, bin_acc_cur;
 	//hough accumulator coordinates, max coords found while binning
-	int hough_x, hough_y, bin_max_r, bin_max_x, bin_max_y;
+	int bin_max_r, bin_max_x, bin_max_y;
+	//accumulator strides (depending on layout), precomputed angle tables, compacted edge pixels
+	acc_strides strides, strides_band;
+	vector<Point>& edge_pts = bufs.edge_pts;
+	//peak scoring factors and per-radius vote tresholds
+	vector<long long> norm_scale, vote_tresh;
+	//start of the currently measured stage (metrics), number of votes cast
+	long long stage_start;
+	long long votes_cnt = 0;
+	long long acc_bytes;
+	//occupancy map filled while voting (one byte per block of occ_block bins), occupancy bitmap of an accumulator,
+	//occupancy bitmap of the final accumulator (peak scans; on the mpi root the union of all received bitmaps),
+	//occupied runs of an accumulator (mpi full), bins merged on the root
+	uchar* occ_map = nullptr;
+	int occ_map_size = 0;
+	vector<unsigned long long> occ, occ_total;
+	vector<int> run_starts, run_lens;
+	long long merge_bins = 0;
+	//hardware counters of the currently measured stage (sequential stages)
+	perf_group perf;
 	//execution time points
 	std::chrono::time_point<std::chrono::high_resolution_clock>
-		time_start_total, 
 		time_start_hough_nompi, 
 		time_end_hough_nompi, 
 		time_end_hough;
 
 #pragma endregion
 
-	//measuring total runtime
-	time_start_total = std::chrono::high_resolution_clock::now();
-
 #pragma region prepare image and accumulator (+ROIs)
 
 	if (imp_type == ImpType::openmpi) {
@@ -167,87 +1203,110 @@ Mat hough::circle(
 
 		if (mpi_type == MpiType::crop && world_rank == 0) {
 			//mpi crop, root, total acc matrix is width + (max_radius * 2)
-			src = new uchar[src_size]();
 			acc_w += (max_radius * 2);
+		}
+		if (mpi_type == MpiType::rows && world_rank == 0) {
+			//mpi rows, root, total acc matrix is height + (max_radius * 2)
+			acc_h += (max_radius * 2);
+		}
+		if (mpi_type != MpiType::full && world_rank == 0) {
 			acc_size = acc_w * acc_h * acc_d;
-			acc = new ushort[acc_size]();
+			acc = take_buffer<T>(bufs.acc, acc_size, mem, "acc");
 		}
 
-		//split image into <n> vertical stripes:
-		src_roi_shiftsize = int(img.cols / (world_size - 1));
+		//split image into <n> vertical stripes (mpi full, crop) or horizontal stripes (mpi rows):
+		src_roi_shiftsize = (mpi_type == MpiType::rows) ? int(img.rows / (world_size - 1)) : int(img.cols / (world_size - 1));
 
 		for (int i = 0; i < (world_size - 1); i++) {
-			int roi_x = src_roi_shiftsize * i;
-			int roi_w = src_roi_shiftsize;
+			int roi_pos = src_roi_shiftsize * i;
+			int roi_len = src_roi_shiftsize;
 			if (i == world_size - 2) {
-				roi_w = img.cols - roi_x;
+				roi_len = ((mpi_type == MpiType::rows) ? img.rows : img.cols) - roi_pos;
 			}
 
-			if (mpi_type == MpiType::crop && world_rank == 0) {
-				//mpi crop, root, cropping src image into multiple rois
-				Mat roi = img(Rect(roi_x, 0, roi_w, src_h));
-				uchar* roi_arr = new uchar[roi_w * src_h]();
-				fill_img_into_2d_array(roi_arr, roi, roi_w, src_h);
-				src_rois.push_back(roi_arr);
+			if (mpi_type == MpiType::rows) {
+				//mpi rows, all processes, cropping accumulator matrices
+				//roi_h + (max_radius * 2) includes external (lying outside of accumulator size) polar coordinates
+				src_rois.push_back(Rect(0, roi_pos, src_w, roi_len));
+				acc_rois.push_back(Rect(0, roi_pos, acc_w, roi_len + (max_radius * 2)));
 			}
-
-			src_roi_sizes.push_back(make_tuple(roi_x, roi_w, roi_w * src_h));
-
-			if (mpi_type == MpiType::crop) {
-				//mpi crop, all processes, cropping accumulator matrices
+			else {
+				//mpi full/crop, all processes, cropping accumulator matrices (only used in mpi crop)
 				//roi_w + (max_radius * 2) includes external (lying outside of accumulator size) polar coordinates
-				int acc_crop_w = roi_w + (max_radius * 2);
-				int acc_crop_size = acc_crop_w * acc_h * acc_d;
-				if (world_rank == 0) {
-					//mpi crop, root, initializing empty cropped accumulator matrices
-					ushort* acc_crop = new ushort[acc_crop_size]();
-					accs.push_back(acc_crop);
-				}
-				accs_sizes.push_back(make_tuple(acc_crop_w, acc_crop_size));
+				src_rois.push_back(Rect(roi_pos, 0, roi_len, src_h));
+				acc_rois.push_back(Rect(roi_pos, 0, roi_len + (max_radius * 2), acc_h));
 			}
 		}
 
+		if (mpi_type != MpiType::full && world_rank == 0 && world_size > 2) {
+			//mpi crop/rows, root, cropped accumulators are received in place into the total accumulator;
+			//neighbouring stripes overlap by (max_radius * 2) columns/rows, only this band is buffered while receiving
+			acc_band_w = (mpi_type == MpiType::crop) ? max_radius * 2 : acc_w;
+			acc_band_h = (mpi_type == MpiType::crop) ? acc_h : max_radius * 2;
+			acc_band_size = acc_band_w * acc_band_h * acc_d;
+			acc_band_buf = take_buffer<T>(bufs.acc_band, acc_band_size, mem, "crop");
+			strides_band = get_acc_strides(acc_band_w, acc_band_h, acc_d, acc_layout);
+		}
+
 		if (mpi_type == MpiType::full) {
-			//mpi full, all processes, initializing full-sized image and accumulator matrices
-			src = new uchar[src_size](); // () initializes all values to 0
-			fill_img_into_2d_array(src, img, src_w, src_h);
-			acc = new ushort[acc_size]();
-			acc_rbuf = new ushort[acc_size]();
+			//mpi full, all processes, initializing full-sized accumulator matrices,
+			//root, receive buffer of the worker accumulators
+			acc = take_buffer<T>(bufs.acc, acc_size, mem, "acc");
+			if (world_rank == 0) {
+				acc_rbuf = take_buffer<T>(bufs.acc_rbuf, acc_size, mem, "rbuf");
+			}
 
 			if (world_rank != 0) {
+				//mpi full, non-root, receiving the full image into its own buffer
+				src_rbuf = take_buffer<uchar>(bufs.src_rbuf, src_size, mem, "src");
+				src = src_rbuf;
+				src_step = src_w;
+
 				//mpi full, non-root, setting ROI X-coordinates
-				src_x = get<0>(src_roi_sizes[world_rank - 1]);
-				src_x2 = src_x + get<1>(src_roi_sizes[world_rank - 1]);
+				src_x = src_rois[world_rank - 1].x;
+				src_x2 = src_x + src_rois[world_rank - 1].width;
 			}
 		}
 
-		if (mpi_type == MpiType::crop && world_rank != 0) {
-			//mpi crop, non-root, initializing image and accumulator with properly cropped sizes
+		if (mpi_type != MpiType::full && world_rank != 0) {
+			//mpi crop/rows, non-root, initializing image and accumulator with properly cropped sizes
 
 			//image, setting ROI limits
-			src_w = get<1>(src_roi_sizes[world_rank - 1]);
+			src_w = src_rois[world_rank - 1].width;
+			src_h = src_rois[world_rank - 1].height;
 			src_x2 = src_w;
-			src_size = get<2>(src_roi_sizes[world_rank - 1]);
-			src = new uchar[src_size]();
+			src_size = src_w * src_h;
+			src_rbuf = take_buffer<uchar>(bufs.src_rbuf, src_size, mem, "src");
+			src = src_rbuf;
+			src_step = src_w;
 
 			//accumulator, setting sizes
-			acc_w = get<0>(accs_sizes[world_rank - 1]);
-			acc_size = get<1>(accs_sizes[world_rank - 1]);
-			acc = new ushort[acc_size]();
+			acc_w = acc_rois[world_rank - 1].width;
+			acc_h = acc_rois[world_rank - 1].height;
+			acc_size = acc_w * acc_h * acc_d;
+			acc = take_buffer<T>(bufs.acc, acc_size, mem, "acc");
 		}
 
+		stage_start = metrics::now();
 		MPI_Barrier(MPI_COMM_WORLD);
+		trace::add("mpi_barrier", stage_start, metrics::now());
 	}
 	else {
 
 		//implementation: seq, omp
-		//initialize image, accumulator
+		//initialize accumulator, the image is read in place
 
-		src = new uchar[src_size]();
-		fill_img_into_2d_array(src, img, src_w, src_h); //fill 1d-array (src) with real 2d-image
-		acc = new ushort[acc_size]();
+		acc = take_buffer<T>(bufs.acc, acc_size, mem, "acc");
+	}
+
+	strides = get_acc_strides(acc_w, acc_h, acc_d, acc_layout);
+	fill_lin_offsets(offs, strides);
+
+	//occupancy map of every voting process
+	if (imp_type != ImpType::openmpi || world_rank != 0) {
+		occ_map_size = (acc_size + occ_block - 1) / occ_block;
+		occ_map = take_buffer<uchar>(bufs.occ_map, occ_map_size, mem, "acc");
 	}
-	
 
 #pragma endregion
 
@@ -255,20 +1314,18 @@ Mat hough::circle(
 
 	if (imp_type == ImpType::openmpi) {
 
-		//mpi, root, send 2d-array of image or its ROIs to every process
+		stage_start = metrics::now();
+
+		//mpi, root, send image or its ROIs to every process, straight from the edge image
+		//(strided datatype: roi.height rows of roi.width bytes, src_step bytes apart), received as contiguous bytes
 		if (world_rank == 0) {
 			for (int i = 1; i < world_size; i++) {
-				if (mpi_type == MpiType::full) {
-					//mpi full, send full image
-					MPI_Send(src, src_size, MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD);
-				}
-				else {
-					//testing image ROIs
-					//imwrite("img" + to_string(i) + ".png", Mat(acc_h, get<1>(src_roi_sizes[i - 1]), CV_8UC1, src_rois[i - 1]));
-
-					//mpi crop, send image ROIs
-					MPI_Send(src_rois[i - 1], get<2>(src_roi_sizes[i - 1]), MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD);
-				}
+				Rect roi = (mpi_type == MpiType::full) ? Rect(0, 0, src_w, src_h) : src_rois[i - 1];
+				MPI_Datatype roi_type;
+				MPI_Type_vector(roi.height, roi.width, src_step, MPI_UNSIGNED_CHAR, &roi_type);
+				MPI_Type_commit(&roi_type);
+				MPI_Send(src + (size_t)src_step * roi.y + roi.x, 1, roi_type, i, 0, MPI_COMM_WORLD);
+				MPI_Type_free(&roi_type);
 			}
 		}
 		else {
@@ -276,40 +1333,60 @@ Mat hough::circle(
 			MPI_Recv(src, src_size, MPI_UNSIGNED_CHAR, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 		}
 
+		metrics::add_stage(run, (world_rank == 0) ? "mpi_send" : "mpi_recv", metrics::now() - stage_start);
+
 		time_start_hough_nompi = std::chrono::high_resolution_clock::now(); //measuring hough runtime without mpi communication 
 	}
 
 	if (imp_type != ImpType::openmpi || (imp_type == ImpType::openmpi && world_rank != 0)) { //don't run in mpi root process
 
-		#pragma omp parallel for num_threads(omp_threads) collapse(2) private(ind, hough_x, hough_y) shared(acc) if(imp_type == ImpType::openmp)
-		//#pragma omp parallel for simd num_threads(omp_threads) collapse(2) private(ind, hough_x, hough_y) shared(acc) if(imp_type == ImpType::openmp)
-		//for every image pixel
-		for (int j = src_y; j < src_h; j++) {
-			for (int i = src_x; i < src_x2; i++) {
+		//edge pixels are compacted into a list first, so voting never scans background pixels
+		//(hough::detect compacted the whole image already for sequential and openmp, mpi workers compact their own image region)
+		if (imp_type == ImpType::openmpi) {
+			stage_start = metrics::now();
+			compact_edges(edge_pts, src, src_step, src_x, src_x2, src_y, src_h, simd_type);
+			metrics::add_stage(run, "edge_compaction", metrics::now() - stage_start);
+		}
+		metrics::add_counter(run, "edge_count", edge_pts.size());
 
-				ind_2d_to_1d(ind, i, j, src_w);
-				if (src[ind] == 255) { //if pixel is edge (255 = white)
+		stage_start = metrics::now();
 
-				//for every radius, draw a circle (360 degrees)
-					for (int r = min_radius; r <= max_radius; r++) {
-						for (int t = 0; t <= 360; t++) {
+		//openmp, and mpi workers with more than one thread (hybrid), vote with all threads
+		bool parallel_vote = imp_type == ImpType::openmp || (imp_type == ImpType::openmpi && omp_threads > 1);
 
-							//find polar coordinates for current circle center at i,j
-							//also convert degrees to radians
-							hough_x = (i + mpi_x_shift) - (r * cos((t * CV_PI) / 180.0)); //mpi_x_shift for proper acc coords in mpi crop
-							hough_y = j - (r * sin((t * CV_PI) / 180.0));
+		if (tile_size != 0 || parallel_vote) {
 
-							//if calculated coords lie within current accumulator
-							if (hough_x >= 0 && hough_x < acc_w && hough_y >= 0 && hough_y < acc_h) {
+			//tiled voting, edge pixels are bucketed into cache-sized tiles
+			//(parallel voting is always tiled: the checkerboard phases keep threads off each other's bins,
+			//so no increment is lost and the accumulator is identical for every thread count)
+			votes_cnt = vote_tiled(acc, occ_map, strides, offs, edge_pts, mpi_x_shift, mpi_y_shift, min_radius, max_radius, acc_w, acc_h,
+				acc_layout, (tile_size <= 0) ? tile_size_auto(max_radius, acc_d, sizeof(T)) : tile_size,
+				parallel_vote, omp_threads, run);
+		}
+		else {
 
-								ind_3d_to_1d(ind, hough_x, hough_y, r - min_radius, acc_w, acc_h);
-								acc[ind] += 1; //vote for this accumulator position
-							}
-						}
-					}
-				}
+			//hardware counters and trace span (if enabled)
+			long long thread_start = metrics::now();
+			perf = perfctr::start();
+
+			//for every edge pixel
+			for (int k = 0; k < (int)edge_pts.size(); k++) {
+
+				//for every radius, draw a circle (360 degrees)
+				//mpi_x_shift/mpi_y_shift for proper acc coords in mpi crop/rows
+				votes_cnt += vote_pixel(acc, occ_map, strides, offs, edge_pts[k].x + mpi_x_shift, edge_pts[k].y + mpi_y_shift, min_radius, max_radius, min_radius, acc_w, acc_h);
 			}
+
+			metrics::add_perf(run, "voting", 0, perfctr::stop(perf));
+			trace::add("voting_thread", thread_start, metrics::now());
 		}
+
+		//occupancy bitmap of the voted accumulator
+		occ_pack(occ_map, acc_size, occ, omp_threads);
+		occ_total = occ;
+
+		metrics::add_stage(run, "voting", metrics::now() - stage_start);
+		metrics::add_counter(run, "vote_count", votes_cnt);
 	}
 
 	//mpi, gather all accumulators from all non-root processes in root
@@ -319,43 +1396,94 @@ Mat hough::circle(
 
 		if (world_rank != 0) {
 			//mpi, non-root, send accumulator to root
-			MPI_Send(acc, acc_size, MPI_UNSIGNED_SHORT, 0, 0, MPI_COMM_WORLD);
+			stage_start = metrics::now();
+			if (mpi_type == MpiType::full) {
+				//mpi full, send the occupancy bitmap first, then only the occupied runs (indexed datatype, no packing)
+				occ_runs(occ, acc_size, run_starts, run_lens);
+				MPI_Send(occ.data(), (int)occ.size(), MPI_UNSIGNED_LONG_LONG, 0, 1, MPI_COMM_WORLD);
+				MPI_Datatype runs_type = acc_runs_type(run_starts, run_lens, acc_mpi_type<T>());
+				MPI_Send(acc, 1, runs_type, 0, 0, MPI_COMM_WORLD);
+				MPI_Type_free(&runs_type);
+			}
+			else {
+				//mpi crop/rows, send the occupancy bitmap first, then the whole cropped accumulator
+				MPI_Send(occ.data(), (int)occ.size(), MPI_UNSIGNED_LONG_LONG, 0, 1, MPI_COMM_WORLD);
+				MPI_Send(acc, acc_size, acc_mpi_type<T>(), 0, 0, MPI_COMM_WORLD);
+			}
+			metrics::add_stage(run, "mpi_send", metrics::now() - stage_start);
 
 		}
 		else {
 			//merging all retrieved accumulators into a single accumulator
+			//(the merged accumulator is occupied wherever any received accumulator is)
+			occ_total.assign((acc_size + occ_block * 64 - 1) / (occ_block * 64), 0);
 			for (int i = 1; i < world_size; i++) {
 				if (mpi_type == MpiType::full) {
-					//mpi full, root, receive accumulators from non-root processes
-					MPI_Recv(acc_rbuf, acc_size, MPI_UNSIGNED_SHORT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-					//mpi full, sum all accumulator coordinates
-					for (int j = 0; j < acc_size; j++) {
-						if (acc_rbuf[j] != 0) {
-							acc[j] += acc_rbuf[j];
-						}
+					//mpi full, root, receive accumulators from non-root processes in arrival order:
+					//the bitmap of whichever worker finished first, then its occupied runs into the receive buffer
+					//(bins outside the runs are never read, so the buffer is not cleared between workers)
+					stage_start = metrics::now();
+					MPI_Status status;
+					occ.assign((acc_size + occ_block * 64 - 1) / (occ_block * 64), 0);
+					MPI_Recv(occ.data(), (int)occ.size(), MPI_UNSIGNED_LONG_LONG, MPI_ANY_SOURCE, 1, MPI_COMM_WORLD, &status);
+					occ_runs(occ, acc_size, run_starts, run_lens);
+					for (size_t w = 0; w < occ.size(); w++) {
+						occ_total[w] |= occ[w];
+					}
+					MPI_Datatype runs_type = acc_runs_type(run_starts, run_lens, acc_mpi_type<T>());
+					MPI_Recv(acc_rbuf, 1, runs_type, status.MPI_SOURCE, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+					MPI_Type_free(&runs_type);
+					metrics::add_stage(run, "mpi_recv", metrics::now() - stage_start);
+
+					//mpi full, sum all occupied runs (vectorized, in parallel)
+					stage_start = metrics::now();
+					perf = perfctr::start();
+					acc_merge(acc, acc_rbuf, run_starts, run_lens, simd_type, omp_threads);
+					for (size_t k = 0; k < run_lens.size(); k++) {
+						merge_bins += run_lens[k];
 					}
+					metrics::add_perf(run, "mpi_merge", 0, perfctr::stop(perf));
+					metrics::add_stage(run, "mpi_merge", metrics::now() - stage_start);
 				}
 				else {
-					//mpi crop, root, receive cropped accumulators from non-root processes
-					MPI_Recv(accs[i - 1], get<1>(accs_sizes[i - 1]), MPI_UNSIGNED_SHORT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-					//mpi crop, retrieve current cropped accumulator width (depending on process id index)
-					accs_cur_w = get<0>(accs_sizes[i - 1]);
+					//mpi crop/rows, retrieve current cropped accumulator region in the total accumulator,
+					//its first (max_radius * 2) columns/rows already hold votes of the previous stripe(s)
+					Rect acc_roi = acc_rois[i - 1];
+					Rect band = Rect(acc_roi.x, acc_roi.y, acc_band_w, acc_band_h);
+
+					//mpi crop/rows, root, save the overlap band before it is overwritten by the in-place receive
+					stage_start = metrics::now();
+					perf = perfctr::start();
+					if (i > 1) {
+						acc_band(acc, strides, acc_band_buf, strides_band, band, acc_d, false, simd_type, omp_threads);
+					}
+					metrics::add_perf(run, "mpi_merge", 0, perfctr::stop(perf));
+					metrics::add_stage(run, "mpi_merge", metrics::now() - stage_start);
+
+					//mpi crop/rows, root, receive the bitmap of the cropped accumulator,
+					//then the cropped accumulator straight into its shifted region (subarray datatype)
+					stage_start = metrics::now();
+					int crop_size = acc_roi.width * acc_roi.height * acc_d;
+					occ.assign((crop_size + occ_block * 64 - 1) / (occ_block * 64), 0);
+					MPI_Recv(occ.data(), (int)occ.size(), MPI_UNSIGNED_LONG_LONG, i, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+					MPI_Datatype region_type = acc_region_type(acc_w, acc_h, acc_d, acc_roi, acc_layout, acc_mpi_type<T>());
+					MPI_Recv(acc, 1, region_type, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+					MPI_Type_free(&region_type);
+					metrics::add_stage(run, "mpi_recv", metrics::now() - stage_start);
 
 					//testing cropped accumulator images
-					//imwrite("acc" + to_string(i) + ".png", Mat(acc_h, accs_cur_w, CV_16S, accs[i - 1]));
-
-					//mpi crop, merge all coords from cropped accumulators into the total accumulator with proper X-shifts
-					for (int x = 0; x < accs_cur_w; x++) {
-						for (int y = 0; y < acc_h; y++) {
-							for (int r = 0; r < acc_d; r++) {
-								ind_3d_to_1d(ind, x, y, r, accs_cur_w, acc_h);
-								ind_3d_to_1d(ind_acc, x + (src_roi_shiftsize * (i - 1)), y, r, acc_w, acc_h);
-								acc[ind_acc] += accs[i - 1][ind]; //merging accumulator votes
-							}
-						}
+					//imwrite("acc" + to_string(i) + ".png", Mat(acc_h, acc_w, CV_16S, acc));
+
+					//mpi crop/rows, merge the saved overlap band back (adding votes)
+					stage_start = metrics::now();
+					perf = perfctr::start();
+					if (i > 1) {
+						acc_band(acc, strides, acc_band_buf, strides_band, band, acc_d, true, simd_type, omp_threads);
+						merge_bins += (long long)acc_band_size;
 					}
+					occ_shift(occ, crop_size, get_acc_strides(acc_roi.width, acc_roi.height, acc_d, acc_layout), acc_roi.height, acc_roi, strides, occ_total);
+					metrics::add_perf(run, "mpi_merge", 0, perfctr::stop(perf));
+					metrics::add_stage(run, "mpi_merge", metrics::now() - stage_start);
 				}
 			}
 
@@ -372,19 +1500,32 @@ Mat hough::circle(
 
 	if (world_rank == 0) {
 
+		stage_start = metrics::now();
+		perf = perfctr::start();
+
+		//scores are only normalized here, voting always counts plain votes
+		fill_norm_scale(norm_scale, offs, use_normalize);
+		fill_vote_tresh(vote_tresh, peak_tresh, acc_d, norm_scale);
+
 		if (!use_binning) {
 
 			//no binning
 
 			//#pragma omp parallel for num_threads(4) collapse(3) shared(acc, circles) if(imp_type == ImpType::openmp)
 			//for every bin coordinate
-			for (int j = 0; j < acc_h; j += 1) {
+			for (int j = mpi_y_shift; j < acc_h - mpi_y_shift; j += 1) {
+
+				//skip rows without any bin reaching the treshold (vectorized scan)
+				if (!region_has_peak(acc, occ_total, strides, mpi_x_shift, acc_w - mpi_x_shift, j, j + 1, vote_tresh, simd_type)) {
+					continue;
+				}
+
 				for (int i = mpi_x_shift; i < acc_w - mpi_x_shift; i += 1) {
 					for (int r = 0; r <= max_radius - min_radius; r++) {
 
-						ind_3d_to_1d(ind, i, j, r, acc_w, acc_h);
-						if (acc[ind] >= peak_tresh) { //if bin value greater than treshold
-							circles.push_back(make_tuple(i - mpi_x_shift, j, r + min_radius, !use_spacing)); //add found circle
+						ind_3d_to_1d(ind, i, j, r, strides);
+						if (acc[ind] >= vote_tresh[r]) { //if bin score greater than treshold
+							circles.push_back(make_tuple(i - mpi_x_shift, j - mpi_y_shift, r + min_radius, !use_spacing, acc_score(acc[ind], r, norm_scale))); //add found circle
 						}
 					}
 				}
@@ -396,27 +1537,32 @@ Mat hough::circle(
 
 			//#pragma omp parallel for num_threads(4) collapse(2) private(bin_acc_current, bin_max_val, bin_max_val_x, bin_max_val_y, bin_max_val_r) shared(acc, circles) if(imp_type == ImpType::openmp)
 			//for every bin
-			for (int j = 0; j < acc_h; j += bin_size) {
+			for (int j = mpi_y_shift; j < acc_h - mpi_y_shift; j += bin_size) {
 				for (int i = mpi_x_shift; i < acc_w - mpi_x_shift; i += bin_size) {
 
+					//skip bins without any bin coordinate reaching the treshold (vectorized scan)
+					if (!region_has_peak(acc, occ_total, strides, i, i + min(bin_size, acc_w - mpi_x_shift - i), j, j + min(bin_size, acc_h - mpi_y_shift - j), vote_tresh, simd_type)) {
+						continue;
+					}
+
 					bin_max = 0;
 					bin_max_r = 0;
 					bin_max_x = 0;
 					bin_max_y = 0;
 
-					//for every bin coordinate
-					for (int y = j; y < j + min(bin_size, acc_h - j); y++) {
+					//for every bin coordinate, locating the first maximum
+					for (int y = j; y < j + min(bin_size, acc_h - mpi_y_shift - j); y++) {
 						for (int x = i; x < i + min(bin_size, acc_w - mpi_x_shift - i); x++) {
 							for (int r = 0; r <= max_radius - min_radius; r++) {
 
-								//finding maximum value per bin
-								ind_3d_to_1d(ind, x, y, r, acc_w, acc_h);
-								bin_acc_cur = acc[ind];
+								//finding maximum score per bin
+								ind_3d_to_1d(ind, x, y, r, strides);
+								bin_acc_cur = acc_score(acc[ind], r, norm_scale);
 
 								if (bin_acc_cur > bin_max) {
 									bin_max = bin_acc_cur;
 									bin_max_x = x - mpi_x_shift;
-									bin_max_y = y;
+									bin_max_y = y - mpi_y_shift;
 									bin_max_r = r + min_radius;
 								}
 							}
@@ -424,23 +1570,27 @@ Mat hough::circle(
 					}
 
 					if (bin_max >= peak_tresh) { //if maximum bin value greater than treshold
-						circles.push_back(make_tuple(bin_max_x, bin_max_y, bin_max_r, !use_spacing)); //add found circle
+						circles.push_back(make_tuple(bin_max_x, bin_max_y, bin_max_r, !use_spacing, (long long)bin_max)); //add found circle
 					}
 				}
 			}
 		}
 
+		metrics::add_perf(run, "peak_extraction", 0, perfctr::stop(perf));
+		metrics::add_stage(run, "peak_extraction", metrics::now() - stage_start);
+		stage_start = metrics::now();
+
 		//spacing, euclidean distance between circles should be bigger than spacing_size
 		if (use_spacing) {
 
 			//#pragma omp parallel for num_threads(4) private(inbetween_ok) shared(circles) if(imp_type == ImpType::openmp)
 			//for every found circle
-			for (int i = 0; i < circles.size(); i++) {
+			for (size_t i = 0; i < circles.size(); i++) {
 
 				inbetween_ok = true;
 
 				//compare with every other circle
-				for (int j = 0; j < circles.size(); j++) {
+				for (size_t j = 0; j < circles.size(); j++) {
 					if (j != i) {
 						//if euclidean distance is lower than spacing_size, flag circle to not be drawn
 						if (get<3>(circles[j]) == true &&
@@ -458,6 +1608,22 @@ Mat hough::circle(
 				}
 			}
 		}
+
+		metrics::add_stage(run, "spacing", metrics::now() - stage_start);
+		stage_start = metrics::now();
+
+		//subpixel refinement of drawn circles, quadratic fit to their 3x3x3 accumulator neighborhood
+		circles_subpx.assign(circles.size(), make_tuple(0.0, 0.0, 0.0));
+
+		for (size_t i = 0; i < circles.size(); i++) {
+			if (get<3>(circles[i]) == true) {
+				refine_peak(acc, strides, get<0>(circles[i]) + mpi_x_shift, get<1>(circles[i]) + mpi_y_shift, get<2>(circles[i]) - min_radius,
+					mpi_x_shift, acc_w - mpi_x_shift, mpi_y_shift, acc_h - mpi_y_shift, acc_d, norm_scale, subpx_off);
+				circles_subpx[i] = make_tuple(get<0>(circles[i]) + subpx_off[0], get<1>(circles[i]) + subpx_off[1], get<2>(circles[i]) + subpx_off[2]);
+			}
+		}
+
+		metrics::add_stage(run, "refinement", metrics::now() - stage_start);
 	}
 
 #pragma endregion
@@ -474,52 +1640,336 @@ Mat hough::circle(
 	auto time_elapsed_hough = chrono::duration_cast<chrono::nanoseconds>(time_end_hough - time_start_total).count();
 	auto time_elapsed_hough_nompi = chrono::duration_cast<chrono::nanoseconds>(time_end_hough_nompi - time_start_hough_nompi).count();
 
-	//save runtimes to list (used for average calculations in evaluation)
-	globals::runtimes.push_back(make_tuple(time_elapsed_total, time_elapsed_hough, time_elapsed_hough_nompi));
+	//runtimes of this transformation, registered by the caller
+	result.time_total = time_elapsed_total;
+	result.time_hough = time_elapsed_hough;
+	result.time_hough_nompi = time_elapsed_hough_nompi;
+	metrics::add_stage(run, "hough_total", time_elapsed_total);
+
+	//accumulator memory of this process: accumulator, receive buffer (mpi full, root), overlap band (mpi crop/rows, root)
+	acc_bytes = acc_size + ((acc_rbuf != nullptr) ? acc_size : 0) + acc_band_size;
+	metrics::add_counter(run, "acc_bytes", acc_bytes * sizeof(T));
+	metrics::add_counter(run, "merge_bins", merge_bins);
+	if (hash_enabled && world_rank == 0) {
+		metrics::add_counter(run, "acc_hash", acc_hash(acc, strides, mpi_x_shift, acc_w - mpi_x_shift, mpi_y_shift, acc_h - mpi_y_shift, acc_d));
+	}
+	metrics::add_counter(run, "mem_src_bytes", memtrack::peak(mem, "src"));
+	metrics::add_counter(run, "mem_acc_bytes", memtrack::peak(mem, "acc"));
+	metrics::add_counter(run, "mem_rbuf_bytes", memtrack::peak(mem, "rbuf"));
+	metrics::add_counter(run, "mem_crop_bytes", memtrack::peak(mem, "crop"));
+	metrics::add_counter(run, "mem_peak_bytes", memtrack::peak_total(mem));
+
+	//collect circles flagged to be drawn
+
+	for (size_t i = 0; i < circles.size(); i++) {
+		if (get<3>(circles[i]) == true) {
+			hough_circle c;
+			c.x = get<0>(circles[i]);
+			c.y = get<1>(circles[i]);
+			c.r = get<2>(circles[i]);
+			c.sub_x = get<0>(circles_subpx[i]);
+			c.sub_y = get<1>(circles_subpx[i]);
+			c.sub_r = get<2>(circles_subpx[i]);
+			c.score = get<4>(circles[i]);
+			result.circles.push_back(c);
+		}
+	}
 
-	cout << world_rank << " time elapsed (total): " << (time_elapsed_total / 1000000.0) << "ms" << endl;
-	cout << world_rank << " time elapsed (hough): " << (time_elapsed_hough / 1000000.0) << "ms" << endl;
-	cout << world_rank << " time elapsed (hough nompi): " << (time_elapsed_hough_nompi / 1000000.0) << "ms" << endl;
+	metrics::add_counter(run, "circle_count", result.circles.size());
+}
 
-	//freeing memory
+/*!
+ * \brief Computes the image and accumulator bytes allocated by the largest MPI process
+		  (or the only process) of a hough transformation, mirroring the allocations in \link hough::circle_acc \endlink.
+ * \param imp_type Implementation type
+ * \param mpi_type MPI field size to send and receive
+ * \param width Image width
+ * \param height Image height
+ * \param min_radius Minimum circle radius
+ * \param max_radius Maximum circle radius
+ * \param world_size Number of all MPI processes
+ * \param elem_size Size of an accumulator counter in bytes
+ * \return Bytes of the largest process
+ */
+long long hough::largest_process_bytes(const ImpType& imp_type, const MpiType& mpi_type, const int& width, const int& height,
+	const int& min_radius, const int& max_radius, const int& world_size, const int& elem_size) {
 
-	delete[] src;
-	delete[] acc;
-	if (imp_type == ImpType::openmpi) {
-		if (mpi_type == MpiType::full) {
-			delete[] acc_rbuf;
-		}
-		else {
-			for (int i = 0; i < accs.size(); i++) {
-				delete[] accs[i];
-				delete[] src_rois[i];
-			}
-		}
+	long long acc_d = max_radius - min_radius + 1;
+	long long src_bytes = (long long)width * height;
+	long long acc_bytes = src_bytes * acc_d * elem_size;
+
+	//voting processes also hold the occupancy map (one byte per block of occ_block bins)
+	long long occ_bytes = (src_bytes * acc_d + occ_block - 1) / occ_block;
+
+	if (imp_type != ImpType::openmpi) {
+		//the image is read in place
+		return acc_bytes + occ_bytes;
+	}
+	if (mpi_type == MpiType::full) {
+		//root holds the accumulator and its receive buffer (the image is read in place),
+		//workers hold the accumulator, the occupancy map and the image receive buffer
+		return max(2 * acc_bytes, src_bytes + acc_bytes + occ_bytes);
 	}
 
-	//draw circles into original image, count circles
+	//mpi crop/rows: root holds the widened accumulator and the overlap band,
+	//workers hold their received ROI and their cropped accumulator
+	//(rows: same as crop with width and height swapped)
+	int len = (mpi_type == MpiType::rows) ? height : width;
+	int side = (mpi_type == MpiType::rows) ? width : height;
+	int roi_shift = len / (world_size - 1);
+	long long root = (long long)(len + 2 * max_radius) * side * acc_d * elem_size;
+	if (world_size > 2) {
+		root += (long long)(2 * max_radius) * side * acc_d * elem_size;
+	}
+	long long largest = 0;
+	for (int i = 0; i < world_size - 1; i++) {
+		int roi_len = (i == world_size - 2) ? len - roi_shift * i : roi_shift;
+		long long crop = (long long)(roi_len + 2 * max_radius) * side * acc_d * elem_size;
+		largest = max(largest, (long long)roi_len * side + crop + crop / elem_size / occ_block + 1);
+	}
+	return max(root, largest);
+}
 
-	Mat output_hough;
-	src_img.copyTo(output_hough);
+/*!
+ * \brief Computes how many occupancy blocks the stencil of one interior edge pixel marks (planar layout).
+		  Every stencil row marks the blocks of its X-range, a range of n bins touches 1 + (n - 1) / occ_block blocks
+		  on average over all X-alignments of the pixel.
+ * \param offs Voting offsets
+ * \return Expected number of marked blocks
+ */
+double hough::stencil_occ_blocks(const acc_offsets& offs) {
+	double blocks = 0;
+	for (size_t k = 0; k < offs.row_dy.size(); k++) {
+		blocks += 1 + (offs.row_dx2[k] - offs.row_dx1[k]) / (double)occ_block;
+	}
+	return blocks;
+}
 
-	for (int i = 0; i < circles.size(); i++) {
-		if (get<3>(circles[i]) == true) { //circle has 'drawn' flag
-			cv::circle(output_hough, Point(get<0>(circles[i]), get<1>(circles[i])), get<2>(circles[i]), Scalar(0, 0, 255), 1, LINE_4);
-			std::cout << world_rank << " circle: x: " << get<0>(circles[i]) << " y: " << get<1>(circles[i]) << " r: " << get<2>(circles[i]) << '\n';
-			circles_found_cnt++; //increment circle count
-		}
+/*!
+ * \brief Computes the size of a hough transformation without running it
+		  (edge pixels, voting offsets per edge pixel, accumulator counter width, voted occupancy blocks per edge pixel).
+ * \param img Edge image
+ * \param min_radius Minimum circle radius
+ * \param max_radius Maximum circle radius
+ * \param stencil_type Voting stencil type
+ * \return Workload
+ */
+hough_workload hough::workload(const Mat& img, const int& min_radius, const int& max_radius, const StencilType& stencil_type) {
+	acc_offsets offs;
+	fill_acc_offsets(offs, min_radius, max_radius, stencil_type, SimdType::simd_scalar);
+
+	hough_workload w;
+	w.edge_cnt = count_edges(img);
+	w.stencil_size = offs.start.back();
+	AccType acc_type = select_acc_type(votes_per_bin_bound(w.edge_cnt, offs));
+	w.acc_elem_size = (acc_type == AccType::acc_u8) ? 1 : (acc_type == AccType::acc_u16) ? 2 : 4;
+	w.occ_blocks = stencil_occ_blocks(offs);
+	return w;
+}
+
+/*!
+ * \brief Records the runtimes of a hough transformation (none if it was refused by the memory budget).
+ * \param result Result of the transformation
+ * \param stats Runtime statistics
+ */
+void hough::record(const hough_result& result, hough_stats& stats) {
+	if (result.refused) {
+		return;
 	}
+	stats.total.record(result.time_total);
+	stats.hough.record(result.time_hough);
+	stats.hough_nompi.record(result.time_hough_nompi);
+}
 
-	//return circle count from image
-	if (world_rank == 0) {
-		cout << world_rank << " circle count: " << circles_found_cnt << endl;
+/*!
+ * \brief Performs a circle hough transformation on an edge image, without drawing or console output.
+		  Compacts the edge pixels of the whole image, then selects the accumulator counter width (8, 16 or 32 bit)
+		  from an upper bound on votes per bin (edge pixels times cached stencil maxima),
+		  so small workloads get a smaller working set and large ones never overflow (params.min_acc_type forces a wider one).
+		  MPI: only the root compacts the whole image and broadcasts the counter width to the workers.
+		  Resolves the SIMD type against the features of the running CPU and builds the voting stencils
+		  (kept in bufs while radii, stencil and SIMD type stay the same).
+		  Refuses to run (no circles) if the largest process would exceed the memory budget;
+		  all MPI processes compute the same size from the same counter width, so they refuse together. Buffers kept from earlier transformations
+		  are freed first if they could push this process over the budget.
+ * \param img Edge image
+ * \param params Transformation parameters
+ * \param world_size Number of all MPI processes
+ * \param world_rank Process ID of an MPI process
+ * \param bufs Working buffers (reused between transformations)
+ * \param result Output found circles (root), execution times and accumulator setup
+ * \param run Metrics to add stages and counters to (one run per detector, see \link hough_engine::begin_run \endlink)
+ * \param mem Buffer accounting of the detector owning bufs
+ */
+void hough::detect(Mat& img, const hough_params& params, const int& world_size, const int& world_rank, hough_buffers& bufs, hough_result& result,
+	run_metrics& run, mem_account& mem) {
+	SimdType simd_run = simd::resolve(params.simd_type);
+
+	if (bufs.offs_min_radius != params.min_radius || bufs.offs_max_radius != params.max_radius ||
+		bufs.offs_stencil != params.stencil_type || bufs.offs_simd != simd_run) {
+		fill_acc_offsets(bufs.offs, params.min_radius, params.max_radius, params.stencil_type, simd_run);
+		bufs.offs_min_radius = params.min_radius;
+		bufs.offs_max_radius = params.max_radius;
+		bufs.offs_stencil = params.stencil_type;
+		bufs.offs_simd = simd_run;
+	}
+
+	//edge pixels of the whole image are compacted once: their count bounds the votes per bin,
+	//sequential and openmp voting read the list as is
+	//(mpi: only the root compacts the whole image and broadcasts the counter type, workers compact their own image region)
+	auto time_start_total = std::chrono::high_resolution_clock::now();
+	AccType acc_type = params.min_acc_type;
+	if (params.imp_type != ImpType::openmpi || world_rank == 0) {
+		long long stage_start = metrics::now();
+		compact_edges(bufs.edge_pts, img.data, (int)img.step, 0, img.cols, 0, img.rows, simd_run);
+		metrics::add_stage(run, "edge_compaction", metrics::now() - stage_start);
+		acc_type = max(params.min_acc_type, select_acc_type(votes_per_bin_bound((int)bufs.edge_pts.size(), bufs.offs)));
+	}
+	if (params.imp_type == ImpType::openmpi) {
+		int acc_type_id = (int)acc_type;
+		MPI_Bcast(&acc_type_id, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		acc_type = (AccType)acc_type_id;
+	}
+
+	result.circles.clear();
+	result.time_total = 0;
+	result.time_hough = 0;
+	result.time_hough_nompi = 0;
+	result.simd_type = simd_run;
+	result.acc_elem_size = (acc_type == AccType::acc_u8) ? 1 : (acc_type == AccType::acc_u16) ? 2 : 4;
+	result.mem_need = largest_process_bytes(params.imp_type, params.mpi_type, img.cols, img.rows, params.min_radius, params.max_radius,
+		world_size, result.acc_elem_size);
+	result.refused = params.mem_budget > 0 && result.mem_need > params.mem_budget;
+
+	//kept buffers grow to at most their bytes plus the bytes needed now
+	if (params.mem_budget > 0 && memtrack::current_total(mem) + result.mem_need > params.mem_budget) {
+		free_buffers(bufs, mem);
+	}
+
+	if (result.refused) {
+		metrics::add_counter(run, "mem_refused", 1);
+		return;
+	}
+
+	if (acc_type == AccType::acc_u8) {
+		circle_acc<uchar>(params.imp_type, params.mpi_type, img, params.min_radius, params.max_radius, params.peak_tresh,
+			params.use_binning, params.bin_size, params.use_spacing, params.spacing_size, world_size, world_rank, params.omp_threads,
+			params.tile_size, params.acc_layout, simd_run, bufs.offs, params.use_normalize, bufs, result, time_start_total, run, mem);
+	}
+	else if (acc_type == AccType::acc_u16) {
+		circle_acc<ushort>(params.imp_type, params.mpi_type, img, params.min_radius, params.max_radius, params.peak_tresh,
+			params.use_binning, params.bin_size, params.use_spacing, params.spacing_size, world_size, world_rank, params.omp_threads,
+			params.tile_size, params.acc_layout, simd_run, bufs.offs, params.use_normalize, bufs, result, time_start_total, run, mem);
+	}
+	else {
+		circle_acc<uint>(params.imp_type, params.mpi_type, img, params.min_radius, params.max_radius, params.peak_tresh,
+			params.use_binning, params.bin_size, params.use_spacing, params.spacing_size, world_size, world_rank, params.omp_threads,
+			params.tile_size, params.acc_layout, simd_run, bufs.offs, params.use_normalize, bufs, result, time_start_total, run, mem);
+	}
+}
+
+/*!
+ * \brief Performs a circle hough transformation on an edge image (see \link hough::detect \endlink).
+		  Records execution times, run metrics are not kept (see \link hough_engine \endlink).
+		  Working buffers and voting stencils are kept per calling thread until the thread ends.
+		  Prints nothing and draws nothing (see \link hough::draw \endlink, \link hough::print \endlink).
+		  Parameters are the same as in \link hough::circle_acc \endlink, except:
+ * \param stencil_type Voting stencil type
+ * \param mem_budget Memory budget per process in bytes (0 = unlimited)
+ * \param stats Runtime statistics to record into (nullptr = none)
+ * \return Found circles (empty on non-root MPI processes and if refused by the memory budget)
+ */
+vector<hough_circle> hough::circle(
+	ImpType imp_type,
+	MpiType mpi_type,
+	Mat& img,
+	const int& min_radius,
+	const int& max_radius,
+	const int& peak_tresh,
+	const bool& use_binning,
+	const int& bin_size,
+	const bool& use_spacing,
+	const int& spacing_size,
+	const int& world_size,
+	const int& world_rank,
+	const int& omp_threads,
+	const int& tile_size,
+	const AccLayout& acc_layout,
+	const SimdType& simd_type,
+	const StencilType& stencil_type,
+	const bool& use_normalize,
+	const long long& mem_budget,
+	hough_stats* stats) {
+
+	hough_params params;
+	params.imp_type = imp_type;
+	params.mpi_type = mpi_type;
+	params.min_radius = min_radius;
+	params.max_radius = max_radius;
+	params.peak_tresh = peak_tresh;
+	params.use_binning = use_binning;
+	params.bin_size = bin_size;
+	params.use_spacing = use_spacing;
+	params.spacing_size = spacing_size;
+	params.omp_threads = omp_threads;
+	params.tile_size = tile_size;
+	params.acc_layout = acc_layout;
+	params.simd_type = simd_type;
+	params.stencil_type = stencil_type;
+	params.use_normalize = use_normalize;
+	params.mem_budget = mem_budget;
+
+	//buffers and stencils are kept per calling thread, so repeated calls reuse them like hough_engine does
+	static thread_local hough_buffers bufs;
+	static thread_local mem_account mem;
+	hough_result result;
+	run_metrics run;
+	detect(img, params, world_size, world_rank, bufs, result, run, mem);
+
+	if (stats != nullptr) {
+		record(result, *stats);
+	}
+
+	return result.circles;
+}
+
+/*!
+ * \brief Draws found circles and their count into a copy of the original image.
+ * \param src_img Original colored image
+ * \param circles Found circles
+ * \return Original image with drawn circles and circle count
+ */
+Mat hough::draw(const Mat& src_img, const vector<hough_circle>& circles) {
+	Mat output_hough;
+	src_img.copyTo(output_hough);
+
+	for (size_t i = 0; i < circles.size(); i++) {
+		cv::circle(output_hough, Point(circles[i].x, circles[i].y), circles[i].r, Scalar(0, 0, 255), 1, LINE_4);
 	}
 
 	//draw circle count (as text) into image
-	putText(output_hough, to_string(circles_found_cnt), Point(0, 15), FONT_HERSHEY_PLAIN, 1.0, CV_RGB(255, 0, 0), 1.0, LINE_AA);
+	putText(output_hough, to_string(circles.size()), Point(0, 15), FONT_HERSHEY_PLAIN, 1.0, CV_RGB(255, 0, 0), 1.0, LINE_AA);
 
 	//testing output image
 	//imwrite("final.png", output_hough);
 
 	return output_hough;
-}
\ No newline at end of file
+}
+
+/*!
+ * \brief Prints found circles and their count (root process).
+ * \param circles Found circles
+ * \param world_rank Process ID of an MPI process
+ */
+void hough::print(const vector<hough_circle>& circles, const int& world_rank) {
+	if (world_rank != 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < circles.size(); i++) {
+		const hough_circle& c = circles[i];
+		std::cout << world_rank << " circle: x: " << c.x << " y: " << c.y << " r: " << c.r
+			<< " (subpixel x: " << c.sub_x << " y: " << c.sub_y << " r: " << c.sub_r << ")" << '\n';
+	}
+	cout << world_rank << " circle count: " << circles.size() << endl;
+}
@@ -1,6 +1,109 @@
 #pragma once
 
 #include "globals.h"
+#include "simd.h"
+#include "metrics.h"
+#include "trace.h"
+#include "memtrack.h"
+#include "stats.h"
+
+/*! \brief Strides (in elements) of each 3D accumulator axis within its 1D-array. */
+struct acc_strides {
+	int x; //!< X-stride
+	int y; //!< Y-stride
+	int z; //!< Z-stride (radius)
+};
+
+/*! \brief Integer voting offsets of all radii, precomputed once per transform. */
+struct acc_offsets {
+	vector<int> start; //!< Index of the first offset of each radius (accumulator depth + 1 entries)
+	vector<int> dx; //!< X-offsets
+	vector<int> dy; //!< Y-offsets
+	vector<int> lin; //!< 1D-array offsets inside a radius plane (dx * strides.x + dy * strides.y)
+	vector<int> row_start; //!< Index of the first stencil row of each radius (accumulator depth + 1 entries)
+	vector<int> row_dy; //!< Y-offset of each stencil row
+	vector<int> row_dx1; //!< Smallest X-offset of each stencil row
+	vector<int> row_dx2; //!< Largest X-offset of each stencil row
+	vector<int> row_lin1; //!< 1D-array offset of the first bin of each stencil row inside a radius plane
+	vector<int> row_lin2; //!< 1D-array offset of the last bin of each stencil row inside a radius plane
+	int reach; //!< Maximum absolute X/Y-offset
+	int stencil_max; //!< Offsets of the largest radius stencil
+	int mult_max; //!< Largest number of equal offsets within a radius stencil
+};
+
+/*! \brief Size of a hough transformation, known before running it. */
+struct hough_workload {
+	int edge_cnt; //!< Number of edge pixels
+	long long stencil_size; //!< Voting offsets per edge pixel (over all radii)
+	int acc_elem_size; //!< Size of an accumulator counter in bytes
+	double occ_blocks; //!< Occupancy blocks (hough::occ_block bins) marked by one interior edge pixel, planar layout, expected over X-alignment
+};
+
+/*! \brief Parameters of a hough transformation (defaults as on the command line). */
+struct hough_params {
+	ImpType imp_type = ImpType::sequential; //!< Implementation type
+	MpiType mpi_type = MpiType::full; //!< MPI field size to send and receive
+	int min_radius = 15; //!< Minimum circle radius
+	int max_radius = 30; //!< Maximum circle radius
+	int peak_tresh = 125; //!< Accumulator peak treshold
+	bool use_binning = true; //!< Binning on/off
+	int bin_size = 32; //!< Bin size
+	bool use_spacing = true; //!< Spacing on/off
+	int spacing_size = 40; //!< Spacing size
+	int omp_threads = 2; //!< Number of OpenMP threads
+	int tile_size = 0; //!< Tile edge length for cache-blocked voting (0 = off, -1 = fit to L2 cache)
+	AccLayout acc_layout = AccLayout::planar; //!< Accumulator memory layout
+	SimdType simd_type = SimdType::simd_auto; //!< SIMD type of vectorized kernels
+	StencilType stencil_type = StencilType::stencil_angles; //!< Voting stencil type
+	bool use_normalize = false; //!< Radius-normalized peak scoring on/off
+	AccType min_acc_type = AccType::acc_u8; //!< Narrowest accumulator counter type (wider than the vote bound needs only if forced)
+	long long mem_budget = 0; //!< Memory budget per process in bytes (0 = unlimited)
+};
+
+/*! \brief Circle found by a hough transformation. */
+struct hough_circle {
+	int x; //!< Center X-coordinate
+	int y; //!< Center Y-coordinate
+	int r; //!< Radius
+	double sub_x; //!< Subpixel center X-coordinate
+	double sub_y; //!< Subpixel center Y-coordinate
+	double sub_r; //!< Subpixel radius
+	long long score; //!< Peak score (votes, or per-mille of the stencil size if normalized)
+};
+
+/*! \brief Result of a hough transformation. */
+struct hough_result {
+	vector<hough_circle> circles; //!< Found circles (root process only)
+	long long time_total; //!< Total runtime in nanoseconds
+	long long time_hough; //!< Hough runtime (including MPI communication) in nanoseconds
+	long long time_hough_nompi; //!< Hough runtime without MPI communication in nanoseconds
+	int acc_elem_size; //!< Size of an accumulator counter in bytes
+	SimdType simd_type; //!< SIMD type the kernels ran with
+	long long mem_need; //!< Bytes allocated by the largest process
+	bool refused; //!< Refused by the memory budget (no circles)
+};
+
+/*! \brief Runtime statistics of hough transformations in nanoseconds (see \link hough_result \endlink). */
+struct hough_stats {
+	sample_stats total; //!< Total runtimes
+	sample_stats hough; //!< Hough runtimes (including MPI communication)
+	sample_stats hough_nompi; //!< Hough runtimes without MPI communication
+};
+
+/*! \brief Working buffers of hough transformations, kept between calls (grown on demand, freed by \link hough::free_buffers \endlink). */
+struct hough_buffers {
+	vector<uchar> acc; //!< Accumulator
+	vector<uchar> acc_rbuf; //!< Accumulator receive buffer (mpi full, root)
+	vector<uchar> acc_band; //!< Accumulator overlap band (mpi crop/rows, root)
+	vector<uchar> occ_map; //!< Occupancy map
+	vector<uchar> src_rbuf; //!< Image receive buffer (mpi non-root)
+	vector<Point> edge_pts; //!< Compacted edge pixels
+	acc_offsets offs; //!< Voting offsets of the last transformation
+	int offs_min_radius = -1; //!< Minimum radius of the voting offsets
+	int offs_max_radius = -1; //!< Maximum radius of the voting offsets
+	StencilType offs_stencil = StencilType::stencil_angles; //!< Stencil type of the voting offsets
+	SimdType offs_simd = SimdType::simd_auto; //!< SIMD type of the voting offsets
+};
 
 /*!
  * \brief Performs hough transform algorithm.
@@ -10,17 +113,111 @@
 class hough
 {
 private:
-	static void fill_img_into_2d_array(uchar* arr, const Mat& img, const int& width, const int& height);
 	static void ind_3d_to_1d(int& ind, const int& x, const int& y, const int& z, const int& width, const int& height);
 	static void ind_1d_to_3d(int ind, int& x, int& y, int& z, const int& width, const int& height);
 	static void ind_2d_to_1d(int& ind, const int& x, const int& y, const int& width);
+	static void ind_3d_to_1d(int& ind, const int& x, const int& y, const int& z, const acc_strides& strides);
+	static acc_strides get_acc_strides(const int& width, const int& height, const int& depth, const AccLayout& layout);
+
+	static const int angles_cnt = 361; //!< Number of angles (0-360 degrees) voted per edge pixel and radius.
+	static bool hash_enabled;
+
+	static int count_edges(const Mat& img);
+	static long long votes_per_bin_bound(const int& edge_cnt, const acc_offsets& offs);
+	static AccType select_acc_type(const long long& votes_bound);
+
+	template <typename T> static MPI_Datatype acc_mpi_type();
+	static MPI_Datatype acc_region_type(const int& acc_w, const int& acc_h, const int& acc_d, const Rect& region,
+		const AccLayout& acc_layout, const MPI_Datatype& elem_type);
+	template <typename T> static long long acc_hash(const T* acc, const acc_strides& strides, const int& x1, const int& x2, const int& y1, const int& y2, const int& acc_d);
+	static MPI_Datatype acc_runs_type(vector<int>& run_starts, vector<int>& run_lens, const MPI_Datatype& elem_type);
+	template <typename T> static void acc_band(T* acc, const acc_strides& strides, T* band, const acc_strides& band_strides,
+		const Rect& region, const int& acc_d, const bool& restore, const SimdType& simd_type, const int& omp_threads);
+	static void occ_pack(const uchar* occ_map, const int& acc_size, vector<unsigned long long>& occ, const int& omp_threads);
+	static bool occ_any(const vector<unsigned long long>& occ, const int& start, const int& len);
+	static void occ_runs(const vector<unsigned long long>& occ, const int& acc_size, vector<int>& run_starts, vector<int>& run_lens);
+	static void occ_shift(const vector<unsigned long long>& occ, const int& crop_size, const acc_strides& crop_strides, const int& crop_h,
+		const Rect& region, const acc_strides& strides, vector<unsigned long long>& occ_total);
+	template <typename T> static void acc_merge(T* dst, const T* src, const vector<int>& run_starts, const vector<int>& run_lens,
+		const SimdType& simd_type, const int& omp_threads);
+	template <typename T> static void acc_vote(T& bin);
+	template <typename T> static void acc_add(T& dst, const T& val);
+	template <typename T> static T* take_buffer(vector<uchar>& buf, const long long& size, mem_account& mem, const string& name);
+
+	static void fill_trig_tables(int* cos_q, int* sin_q);
+	static void fill_stencil_midpoint(const int& r, vector<Point>& pts);
+	static void fill_acc_offsets(acc_offsets& offs, const int& min_radius, const int& max_radius, const StencilType& stencil_type, const SimdType& simd_type);
+	static void fill_lin_offsets(acc_offsets& offs, const acc_strides& strides);
+	static void mark_occupied(uchar* occ_map, const int& ind1, const int& ind2);
+	static void compact_edges(vector<Point>& edge_pts, const uchar* src, const int& src_step, const int& x1, const int& x2, const int& y1, const int& y2, const SimdType& simd_type);
+	static int tile_size_auto(const int& max_radius, const int& acc_d, const int& elem_size);
+	static double stencil_occ_blocks(const acc_offsets& offs);
+
+	template <typename T>
+	static long long vote_pixel(T* acc, uchar* occ_map, const acc_strides& strides, const acc_offsets& offs,
+		const int& x, const int& y, const int& r1, const int& r2, const int& min_radius, const int& acc_w, const int& acc_h);
+
+	template <typename T>
+	static long long vote_tiled(T* acc, uchar* occ_map, const acc_strides& strides, const acc_offsets& offs,
+		const vector<Point>& edge_pts, const int& x_shift, const int& y_shift, const int& min_radius, const int& max_radius,
+		const int& acc_w, const int& acc_h, const AccLayout& acc_layout, const int& tile_size,
+		const bool& parallel, const int& omp_threads, run_metrics& run);
+
+	template <typename T>
+	static bool region_has_peak(const T* acc, const vector<unsigned long long>& occ, const acc_strides& strides, const int& x1, const int& x2, const int& y1, const int& y2,
+		const vector<long long>& vote_tresh, const SimdType& simd_type);
+
+	static void fill_norm_scale(vector<long long>& norm_scale, const acc_offsets& offs, const bool& use_normalize);
+	static long long acc_score(const long long& votes, const int& z, const vector<long long>& norm_scale);
+	static double parabola_offset(const double& lo, const double& mid, const double& hi);
+	template <typename T>
+	static void refine_peak(const T* acc, const acc_strides& strides, const int& x, const int& y, const int& z,
+		const int& x1, const int& x2, const int& y1, const int& y2, const int& acc_d, const vector<long long>& norm_scale, double* off);
+	static void fill_vote_tresh(vector<long long>& vote_tresh, const int& peak_tresh, const int& acc_d, const vector<long long>& norm_scale);
+
+	template <typename T>
+	static void circle_acc(
+		ImpType imp_type,
+		MpiType mpi_type,
+		Mat& src,
+		const int& min_radius,
+		const int& max_radius,
+		const int& peak_tresh,
+		const bool& use_binning,
+		const int& bin_size,
+		const bool& use_spacing,
+		const int& spacing_size,
+		const int& world_size,
+		const int& world_rank,
+		const int& omp_threads,
+		const int& tile_size,
+		const AccLayout& acc_layout,
+		const SimdType& simd_type,
+		acc_offsets& offs,
+		const bool& use_normalize,
+		hough_buffers& bufs,
+		hough_result& result,
+		const std::chrono::time_point<std::chrono::high_resolution_clock>& time_start_total,
+		run_metrics& run,
+		mem_account& mem);
 
 public:
-	static Mat circle(
+	static const long long norm_ref = 1000; //!< Normalized peak score of a fully voted stencil (per-mille).
+	static const int occ_block = 64; //!< Accumulator bins per occupancy bit (MPI merges and peak scans skip empty blocks).
+
+	static void enable_acc_hash(const bool& on);
+	static void record(const hough_result& result, hough_stats& stats);
+	static void free_buffers(hough_buffers& bufs, mem_account& mem);
+	static void detect(Mat& src, const hough_params& params, const int& world_size, const int& world_rank, hough_buffers& bufs, hough_result& result,
+		run_metrics& run, mem_account& mem);
+	static hough_workload workload(const Mat& img, const int& min_radius, const int& max_radius, const StencilType& stencil_type);
+	static long long largest_process_bytes(const ImpType& imp_type, const MpiType& mpi_type, const int& width, const int& height,
+		const int& min_radius, const int& max_radius, const int& world_size, const int& elem_size);
+
+	static vector<hough_circle> circle(
 		ImpType imp_type, 
 		MpiType mpi_type,
 		Mat& src,
-		Mat& src_image,
 		const int& min_radius,
 		const int& max_radius,
 		const int& peak_tresh,
@@ -30,6 +227,15 @@ public:
 		const int& spacing_size,
 		const int& world_size,
 		const int& world_rank,
-		const int& omp_threads);
+		const int& omp_threads,
+		const int& tile_size = 0,
+		const AccLayout& acc_layout = AccLayout::planar,
+		const SimdType& simd_type = SimdType::simd_auto,
+		const StencilType& stencil_type = StencilType::stencil_angles,
+		const bool& use_normalize = false,
+		const long long& mem_budget = 0,
+		hough_stats* stats = nullptr);
+	static Mat draw(const Mat& src_img, const vector<hough_circle>& circles);
+	static void print(const vector<hough_circle>& circles, const int& world_rank);
 };
 
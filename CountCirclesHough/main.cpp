@@ -36,7 +36,11 @@
 #include "globals.h"
 #include "blur.h"
 #include "edges.h"
-#include "hough.h"
+#include "engine.h"
+#include "metrics.h"
+#include "trace.h"
+#include "planner.h"
+#include "memtrack.h"
 #include <thread>
 
 using namespace cv;
@@ -58,6 +62,10 @@ Mat output_blur;
 Mat output_edges;
 /*! \brief Output input image with drawn circles and circle count. */
 Mat output_hough;
+/*! \brief Circles found by the last hough run. */
+vector<hough_circle> circles_found;
+/*! \brief Circle detector, keeps its buffers and stencils across all hough runs and records their runtimes (evaluation averages). */
+hough_engine detector;
 
 //input parameters
 
@@ -69,8 +77,15 @@ MpiType mpi_type = MpiType::full;
 BlurType blur_type = BlurType::median;
 /*! \brief Currently active edge detection algorithm. */
 EdgesType edges_type = EdgesType::canny;
+/*! \brief Currently active accumulator memory layout. */
+AccLayout acc_layout = AccLayout::planar;
+/*! \brief Currently active instruction set of vectorized kernels. */
+SimdType simd_type = SimdType::simd_auto;
+/*! \brief Currently active voting stencil. */
+StencilType stencil_type = StencilType::stencil_angles;
 
 bool gui = true; //!< GUI on/off (if false, runs evaluation).
+bool draw_output = true; //!< Draw and print found circles after each hough run (always on in GUI mode).
 int eval_times = 10; //!< Number of times to run evaluation on hough.
 int omp_threads = 4; //!< Number of OpenMP threads.
 int blur_ksize = 5; //!< Blur kernel size (must be odd, between 1 to 21).
@@ -85,6 +100,18 @@ bool use_binning = true; //!< Binning on/off.
 int bin_size = 30; //!< Bin size (5-200).
 bool use_spacing = true; //!< Spacing on/off.
 int spacing_size = 40; //!< Spacing size (0-200).
+bool use_normalize = false; //!< Radius-normalized peak scoring on/off (peak treshold becomes per-mille of the circle stencil, 0-1000).
+string metrics_path = ""; //!< Per-run metrics output file (empty = off).
+MetricsFormat metrics_format = MetricsFormat::metrics_json; //!< Per-run metrics output format.
+int metrics_run = 0; //!< Index of the next run written to the metrics file.
+string trace_path = ""; //!< Chrome trace-event output file (empty = off).
+bool imp_auto = false; //!< Implementation type picked by the planner (-imp=3).
+bool plan_log = false; //!< Print work and runtime estimates of all implementation types.
+plan_model model = planner::default_model(); //!< Runtime model of the planner.
+plan_estimate plan_used; //!< Estimate of the implementation type of the next hough run.
+bool use_mpi = false; //!< MPI initialized.
+int mem_budget = 0; //!< Memory budget per process in MB (0 = unlimited).
+int tile_size = 0; //!< Tile size for cache-blocked voting (0 = off, -1 = fit to L2 cache).
 
 //mpi-related fields
 
@@ -132,28 +159,135 @@ void fix_vals() {
 	}
 }
 
+/*!
+* \brief Estimates the work of all implementation types from the current edge image.
+         With -imp=3, switches to the predicted-fastest implementation type (picked by root, broadcast to all MPI processes).
+*/
+void plan_hough() {
+	if (!imp_auto && !plan_log) {
+		return;
+	}
+
+	hough_workload w = hough::workload(output_edges, min_radius, max_radius, stencil_type);
+	vector<plan_estimate> estimates = planner::estimate(w, output_edges.cols, output_edges.rows, min_radius, max_radius, world_size, omp_threads, model);
+
+	if (imp_auto) {
+		plan_estimate best = planner::select(estimates, world_size > 1);
+		int choice[2] = { (int)best.imp_type, (int)best.mpi_type };
+
+		if (use_mpi) {
+			//root's choice is binding, so no process waits for a transform the others skip
+			MPI_Bcast(choice, 2, MPI_INT, 0, MPI_COMM_WORLD);
+		}
+		imp_type = static_cast<ImpType>(choice[0]);
+		mpi_type = static_cast<MpiType>(choice[1]);
+	}
+	plan_used = planner::find(estimates, imp_type, mpi_type);
+
+	if (world_rank == 0) {
+		planner::print(estimates, world_rank);
+		cout << world_rank << " plan: running imp: " << imp_type << " mpi: " << mpi_type << endl;
+	}
+}
+
+/*!
+* \brief Compares the estimate of the last hough run with its actual runtime (console and metrics).
+*/
+void plan_report() {
+	if (!imp_auto && !plan_log) {
+		return;
+	}
+
+	metrics::add_counter(detector.metrics(), "est_vote_count", plan_used.votes);
+	metrics::add_counter(detector.metrics(), "est_hough_ns", (long long)plan_used.ns);
+
+	if (world_rank == 0) {
+		cout << world_rank << " plan: estimated: " << (plan_used.ns / 1000000.0) << "ms actual: " << (metrics::stage(detector.metrics(), "hough_total") / 1000000.0) << "ms" << endl;
+	}
+}
+
+/*!
+* \brief Returns the hough parameters of the current input parameters.
+*/
+hough_params hough_settings() {
+	hough_params params;
+	params.imp_type = imp_type;
+	params.mpi_type = mpi_type;
+	params.min_radius = min_radius;
+	params.max_radius = max_radius;
+	params.peak_tresh = peak_tresh;
+	params.use_binning = use_binning;
+	params.bin_size = bin_size;
+	params.use_spacing = use_spacing;
+	params.spacing_size = spacing_size;
+	params.omp_threads = omp_threads;
+	params.tile_size = tile_size;
+	params.acc_layout = acc_layout;
+	params.simd_type = simd_type;
+	params.stencil_type = stencil_type;
+	params.use_normalize = use_normalize;
+	params.mem_budget = (long long)mem_budget * 1024 * 1024;
+	return params;
+}
+
+/*!
+* \brief Runs the hough transform with the current input parameters and prints its counter width and execution times.
+*/
+void run_hough() {
+	detector.set_params(hough_settings());
+	const hough_result& result = detector.detect(output_edges);
+	circles_found = result.circles;
+
+	cout << world_rank << " accumulator counter: " << (result.acc_elem_size * 8) << "-bit, simd: " << simd::name(result.simd_type) << endl;
+
+	if (result.refused) {
+		cout << world_rank << " memory budget exceeded: " << result.mem_need << " bytes needed, budget " << detector.params().mem_budget << " bytes" << endl;
+		return;
+	}
+
+	cout << world_rank << " time elapsed (total): " << (result.time_total / 1000000.0) << "ms" << endl;
+	cout << world_rank << " time elapsed (hough): " << (result.time_hough / 1000000.0) << "ms" << endl;
+	cout << world_rank << " time elapsed (hough nompi): " << (result.time_hough_nompi / 1000000.0) << "ms" << endl;
+}
+
+/*!
+* \brief Prints the circles found by the last hough run and draws them into the output image (root, timed as the drawing stage).
+         Separate from the hough run, so evaluation times exclude it; skipped if drawing is off.
+*/
+void draw_hough() {
+	if (!draw_output) {
+		return;
+	}
+
+	hough::print(circles_found, world_rank);
+
+	if (world_rank == 0) {
+		long long stage_start = metrics::now();
+		output_hough = hough::draw(input_color, circles_found);
+		metrics::add_stage(detector.metrics(), "drawing", metrics::now() - stage_start);
+	}
+}
+
 /*!
 * \brief Runs hough transform to find and count all circles. Outputs image with found circles.
 */
 void do_hough() {
 
+	plan_hough();
+
+	if (world_rank != 0 && imp_type != ImpType::openmpi) {
+		//root runs a single-process implementation, workers idle until the next update
+		return;
+	}
+
 	cout << "\n" << world_rank << " loading.." << endl;
 
-	output_hough = hough::circle(
-		imp_type,
-		mpi_type,
-		output_edges,
-		input_color,
-		min_radius,
-		max_radius,
-		peak_tresh,
-		use_binning,
-		bin_size,
-		use_spacing,
-		spacing_size,
-		world_size,
-		world_rank,
-		omp_threads);
+	run_hough();
+
+	draw_hough();
+	plan_report();
+	metrics::write(detector.metrics(), metrics_path, metrics_format, world_rank, metrics_run++, imp_type, mpi_type);
+	trace::write(trace_path, world_rank, world_size, imp_type == ImpType::openmpi);
 
 	cout << world_rank << " done.\n" << endl;
 
@@ -167,12 +301,19 @@ void do_hough() {
 */
 void do_edges() {
 
+	long long stage_start = metrics::now();
+
 	if (edges_type == EdgesType::canny) {
 		output_edges = edges::canny(output_blur, canny_tresh1, canny_tresh2, edges_ksize);
 	}
 	else if (edges_type == EdgesType::sobel) {
 		output_edges = edges::sobel(output_blur, sobel_bw_tresh, edges_ksize);
 	}
+	else if (edges_type == EdgesType::gaussian_sobel) {
+		output_edges = edges::gaussian_sobel(input_gs, blur_ksize, sobel_bw_tresh, edges_ksize, omp_threads);
+	}
+
+	metrics::add_stage(detector.metrics(), "edges", metrics::now() - stage_start);
 
 	if (world_rank == 0) {
 		imshow(win_edges, output_edges);
@@ -185,12 +326,24 @@ void do_edges() {
 */
 void do_blur() {
 
-	if (blur_type == BlurType::median) {
+	detector.begin_run();
+	long long stage_start = metrics::now();
+
+	if (edges_type == EdgesType::gaussian_sobel) {
+		//blurring is part of the fused edge detection
+		output_blur = input_gs;
+	}
+	else if (blur_type == BlurType::median) {
 		output_blur = blur::median(input_gs, blur_ksize);
 	}
 	else if (blur_type == BlurType::gaussian) {
 		output_blur = blur::gaussian(input_gs, blur_ksize);
 	}
+	else if (blur_type == BlurType::median_const) {
+		output_blur = blur::median_const(input_gs, blur_ksize, omp_threads, simd_type);
+	}
+
+	metrics::add_stage(detector.metrics(), "blur", metrics::now() - stage_start);
 
 	if (world_rank == 0) {
 		imshow(win_blur, output_blur);
@@ -223,6 +376,7 @@ int main(int argc, char* argv[])
 		"{eval-times|10|}"
 		"{omp-threads|2|}"
 		"{gui|1|}"
+		"{draw|0|}"
 		"{blur-ksize|5|}"
 		"{edges-ksize|3|}"
 		"{sobel-bw-tresh|128|}"
@@ -234,7 +388,21 @@ int main(int argc, char* argv[])
 		"{use-binning|1|}"
 		"{bin-size|32|}"
 		"{use-spacing|1|}"
-		"{spacing-size|40|}";
+		"{spacing-size|40|}"
+		"{tile-size|0|}"
+		"{acc-layout|0|}"
+		"{simd|3|}"
+		"{stencil|0|}"
+		"{normalize|0|}"
+		"{metrics||}"
+		"{metrics-format|1|}"
+		"{perf|0|}"
+		"{trace||}"
+		"{plan|0|}"
+		"{plan-model||}"
+		"{mem-budget|0|}"
+		"{mem-rss|0|}"
+		"{acc-hash|0|}";
 
 	cv::CommandLineParser cmd(argc, argv, keys);
 
@@ -245,6 +413,7 @@ int main(int argc, char* argv[])
 	eval_times = cmd.get<int>("eval-times");
 	omp_threads = cmd.get<int>("omp-threads");
 	gui = cmd.get<int>("gui");
+	draw_output = gui || cmd.get<int>("draw");
 
 	blur_ksize = cmd.get<int>("blur-ksize");
 	sobel_bw_tresh = cmd.get<int>("sobel-bw-tresh");
@@ -258,9 +427,30 @@ int main(int argc, char* argv[])
 	bin_size = cmd.get<int>("bin-size");
 	use_spacing = cmd.get<int>("use-spacing");
 	spacing_size = cmd.get<int>("spacing-size");
+	tile_size = cmd.get<int>("tile-size");
+	acc_layout = static_cast<AccLayout>(cmd.get<int>("acc-layout"));
+	simd_type = static_cast<SimdType>(cmd.get<int>("simd"));
+	stencil_type = static_cast<StencilType>(cmd.get<int>("stencil"));
+	use_normalize = cmd.get<int>("normalize");
+	metrics_path = cmd.get<string>("metrics");
+	metrics_format = static_cast<MetricsFormat>(cmd.get<int>("metrics-format"));
+	perfctr::enable(cmd.get<int>("perf"));
+	trace_path = cmd.get<string>("trace");
+	trace::enable(!trace_path.empty());
+	imp_auto = (imp_type == ImpType::automatic);
+	plan_log = cmd.get<int>("plan");
+	model = planner::parse_model(cmd.get<string>("plan-model"));
+	mem_budget = cmd.get<int>("mem-budget");
+	memtrack::enable_rss(cmd.get<int>("mem-rss"));
+	hough::enable_acc_hash(cmd.get<int>("acc-hash"));
+
+	//decoding and grayscale conversion run once, they stay in the metrics of every run
+	long long stage_start = metrics::now();
 
 	src = imread(cmd.get<string>("@img"), IMREAD_COLOR);
 
+	metrics::add_stage(detector.metrics(), "decode", metrics::now() - stage_start, true);
+
 	if (!src.data)
 	{
 		cout << "Input data invalid." << endl;
@@ -270,13 +460,16 @@ int main(int argc, char* argv[])
 
 	//convert rgb to grayscale image
 
-	src.copyTo(input_color);
+	stage_start = metrics::now();
+
+	input_color = src; //shares the decoded pixels, src is not touched afterwards
 
-	cv::cvtColor(src, src, COLOR_BGR2GRAY);
+	cv::cvtColor(input_color, input_gs, COLOR_BGR2GRAY);
 	/*
-	cv::imwrite("../images/bw.png", src);
+	cv::imwrite("../images/bw.png", input_gs);
 	*/
-	src.copyTo(input_gs);
+
+	metrics::add_stage(detector.metrics(), "grayscale", metrics::now() - stage_start, true);
 
 
 	//init mpi
@@ -284,7 +477,8 @@ int main(int argc, char* argv[])
 	struct params_update params;
 	MPI_Datatype params_update;
 
-	if (imp_type == ImpType::openmpi) {
+	if (imp_type == ImpType::openmpi || imp_auto) {
+		use_mpi = true;
 		MPI_Init(&argc, &argv);
 		MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 		MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
@@ -297,8 +491,16 @@ int main(int argc, char* argv[])
 		MPI_Aint disp[5] = { sizeof(int) * 0, sizeof(int) * 1, sizeof(int) * 2, sizeof(int) * 3, sizeof(int) * 4 };
 		MPI_Type_create_struct(5, blocklen, disp, type, &params_update);
 		MPI_Type_commit(&params_update);
+
+		if (imp_auto) {
+			//provisional until the planner has seen the edge image
+			imp_type = (world_size > 1) ? ImpType::openmpi : ImpType::openmp;
+		}
 	}
 
+	//aligning trace clocks of all mpi processes
+	trace::sync_clock(use_mpi);
+
 	//drawing windows and trackbars
 
 	if (gui) {
@@ -317,14 +519,14 @@ int main(int argc, char* argv[])
 			createTrackbar("tresh1", win_edges, &canny_tresh1, 500);
 			createTrackbar("tresh2", win_edges, &canny_tresh2, 500);
 		}
-		else if (edges_type == EdgesType::sobel) {
+		else if (edges_type == EdgesType::sobel || edges_type == EdgesType::gaussian_sobel) {
 			createTrackbar("bw tresh", win_edges, &sobel_bw_tresh, 255);
 		}
 		createTrackbar("ksize", win_edges, &edges_ksize, 7);
 
 		createTrackbar("min radius", win_hough, &min_radius, 200);
 		createTrackbar("max radius", win_hough, &max_radius, 200);
-		createTrackbar("peak tresh", win_hough, &peak_tresh, 500);
+		createTrackbar("peak tresh", win_hough, &peak_tresh, use_normalize ? (int)hough::norm_ref : 500);
 
 		if (use_binning) {
 			createTrackbar("bin size", win_hough, &bin_size, 200);
@@ -351,9 +553,10 @@ int main(int argc, char* argv[])
 
 					fix_vals();
 
-					if (imp_type == ImpType::openmpi) {
+					if (use_mpi) {
 
 						//fill parameters update struct to be send
+						//(sent with -imp=3 as well, workers plan along and idle if the planner picks a single-process type)
 						params.bin_size = bin_size;
 						params.max_radius = max_radius;
 						params.min_radius = min_radius;
@@ -395,12 +598,25 @@ int main(int argc, char* argv[])
 
 		fix_vals();
 
-		if (blur_type == BlurType::median) {
+		//blur and edge detection run once, they stay in the metrics of every hough run
+		stage_start = metrics::now();
+
+		if (edges_type == EdgesType::gaussian_sobel) {
+			//blurring is part of the fused edge detection
+			output_blur = input_gs;
+		}
+		else if (blur_type == BlurType::median) {
 			output_blur = blur::median(input_gs, blur_ksize);
 		}
 		else if (blur_type == BlurType::gaussian) {
 			output_blur = blur::gaussian(input_gs, blur_ksize);
 		}
+		else if (blur_type == BlurType::median_const) {
+			output_blur = blur::median_const(input_gs, blur_ksize, omp_threads, simd_type);
+		}
+
+		metrics::add_stage(detector.metrics(), "blur", metrics::now() - stage_start, true);
+		stage_start = metrics::now();
 
 		if (edges_type == EdgesType::canny) {
 			output_edges = edges::canny(output_blur, canny_tresh1, canny_tresh2, edges_ksize);
@@ -408,62 +624,70 @@ int main(int argc, char* argv[])
 		else if (edges_type == EdgesType::sobel) {
 			output_edges = edges::sobel(output_blur, sobel_bw_tresh, edges_ksize);
 		}
+		else if (edges_type == EdgesType::gaussian_sobel) {
+			output_edges = edges::gaussian_sobel(input_gs, blur_ksize, sobel_bw_tresh, edges_ksize, omp_threads);
+		}
+
+		metrics::add_stage(detector.metrics(), "edges", metrics::now() - stage_start, true);
+
+		plan_hough();
+
+		if (world_rank != 0 && imp_type != ImpType::openmpi) {
+			//root runs a single-process implementation, workers are not needed
+			MPI_Finalize();
+			return 0;
+		}
 
-		//record execution times of hough
+		//record execution times of hough (runs refused by the memory budget are not recorded)
 
-		long long sum_total = 0;
-		long long sum_hough = 0;
-		long long sum_mpi = 0;
+		hough_stats& hough_times = detector.stats();
+		hough_times.total.reset();
+		hough_times.hough.reset();
+		hough_times.hough_nompi.reset();
 
 		for (int i = 0; i < eval_times; i++) {
 
 			if (imp_type == ImpType::openmpi) {
+				stage_start = metrics::now();
 				MPI_Barrier(MPI_COMM_WORLD);
+				trace::add("mpi_barrier", stage_start, metrics::now());
 			}
 
-			output_hough = hough::circle(
-				imp_type,
-				mpi_type,
-				output_edges,
-				input_color,
-				min_radius,
-				max_radius,
-				peak_tresh,
-				use_binning,
-				bin_size,
-				use_spacing,
-				spacing_size,
-				world_size,
-				world_rank,
-				omp_threads);
+			detector.begin_run();
 
-			cout << endl;
+			run_hough();
+
+			draw_hough();
+			plan_report();
+			metrics::write(detector.metrics(), metrics_path, metrics_format, world_rank, i, imp_type, mpi_type);
 
-			sum_total += get<0>(globals::runtimes[i]);
-			sum_hough += get<1>(globals::runtimes[i]);
-			sum_mpi += get<2>(globals::runtimes[i]);
+			cout << endl;
 		}
 
 		//calculating average
 
-		double avg_total = sum_total / (eval_times * 1000000.0);
-		double avg_hough = sum_hough / (eval_times * 1000000.0);
-		double avg_hough_nompi = sum_mpi / (eval_times * 1000000.0);
+		double avg_total = hough_times.total.mean() / 1000000.0;
+		double avg_hough = hough_times.hough.mean() / 1000000.0;
+		double avg_hough_nompi = hough_times.hough_nompi.mean() / 1000000.0;
 
 		cout << world_rank << " time elapsed avg (total): " << avg_total << " ms" << endl;
 		cout << world_rank << " time elapsed avg (hough): " << avg_hough << " ms" << endl;
 		cout << world_rank << " time elapsed avg (hough nompi): " << avg_hough_nompi << " ms" << endl;
+		cout << world_rank << " time elapsed sd/p50/p95 (total): " << (hough_times.total.stddev() / 1000000.0) << " / "
+			<< (hough_times.total.percentile(0.5) / 1000000.0) << " / " << (hough_times.total.percentile(0.95) / 1000000.0) << " ms" << endl;
 
 		//write average to file
 
 		std::ofstream times;
 		times.open("avg.txt", std::ios_base::app);
 		times << world_rank << ";" << imp_type << ";" << avg_total << ";" << avg_hough << ";" << avg_hough_nompi << std::endl;
+
+		trace::write(trace_path, world_rank, world_size, imp_type == ImpType::openmpi);
 	}
 
 	//finalize mpi
 
-	if (imp_type == ImpType::openmpi) {
+	if (use_mpi) {
 		MPI_Finalize();
 	}
 
@@ -0,0 +1,128 @@
+#include "memtrack.h"
+
+/*! \brief Resident set size sampling on/off. */
+bool memtrack::rss_enabled = false;
+
+/*!
+ * \brief Starts a new run. Peaks restart from the currently allocated bytes.
+ * \param mem Accounted bytes of a detector
+ */
+void memtrack::begin_run(mem_account& mem) {
+	for (size_t i = 0; i < mem.classes.size(); i++) {
+		get<2>(mem.classes[i]) = get<1>(mem.classes[i]);
+	}
+	mem.total_peak = mem.total;
+}
+
+/*!
+ * \brief Accounts an allocation. Takes no lock: every detector accounts its own buffers.
+ * \param mem Accounted bytes of a detector
+ * \param name Buffer class
+ * \param bytes Allocated bytes
+ */
+void memtrack::alloc(mem_account& mem, const string& name, const long long& bytes) {
+	mem.total += bytes;
+	mem.total_peak = max(mem.total_peak, mem.total);
+	for (size_t i = 0; i < mem.classes.size(); i++) {
+		if (get<0>(mem.classes[i]) == name) {
+			get<1>(mem.classes[i]) += bytes;
+			get<2>(mem.classes[i]) = max(get<2>(mem.classes[i]), get<1>(mem.classes[i]));
+			return;
+		}
+	}
+	mem.classes.push_back(make_tuple(name, bytes, bytes));
+}
+
+/*!
+ * \brief Accounts a release.
+ * \param mem Accounted bytes of a detector
+ * \param name Buffer class
+ * \param bytes Released bytes
+ */
+void memtrack::release(mem_account& mem, const string& name, const long long& bytes) {
+	mem.total -= bytes;
+	for (size_t i = 0; i < mem.classes.size(); i++) {
+		if (get<0>(mem.classes[i]) == name) {
+			get<1>(mem.classes[i]) -= bytes;
+			break;
+		}
+	}
+}
+
+/*!
+ * \brief Returns the peak bytes of a buffer class in the current run (0 if never allocated).
+ * \param mem Accounted bytes of a detector
+ * \param name Buffer class
+ */
+long long memtrack::peak(const mem_account& mem, const string& name) {
+	for (size_t i = 0; i < mem.classes.size(); i++) {
+		if (get<0>(mem.classes[i]) == name) {
+			return get<2>(mem.classes[i]);
+		}
+	}
+	return 0;
+}
+
+/*!
+ * \brief Returns the peak bytes over all buffer classes in the current run.
+ * \param mem Accounted bytes of a detector
+ */
+long long memtrack::peak_total(const mem_account& mem) {
+	return mem.total_peak;
+}
+
+/*!
+ * \brief Returns the bytes currently allocated over all buffer classes.
+ * \param mem Accounted bytes of a detector
+ */
+long long memtrack::current_total(const mem_account& mem) {
+	return mem.total;
+}
+
+/*!
+ * \brief Turns resident set size sampling on or off.
+ * \param on Sampling on/off
+ */
+void memtrack::enable_rss(const bool& on) {
+	rss_enabled = on;
+}
+
+/*!
+ * \brief Returns whether resident set size sampling is on.
+ */
+bool memtrack::rss_is_enabled() {
+	return rss_enabled;
+}
+
+/*!
+ * \brief Reads a size field of /proc/self/status.
+ * \param key Field name (e.g. VmHWM)
+ * \return Size in kB, -1 if unavailable
+ */
+long long memtrack::read_status_kb(const string& key) {
+	ifstream status("/proc/self/status");
+	string line;
+	while (getline(status, line)) {
+		if (line.compare(0, key.size() + 1, key + ":") == 0) {
+			return atoll(line.c_str() + key.size() + 1);
+		}
+	}
+	return -1;
+}
+
+/*!
+ * \brief Returns the peak resident set size of the process since the last \link memtrack::reset_rss_peak \endlink.
+ * \return Peak resident set size in kB, -1 if unavailable
+ */
+long long memtrack::rss_peak_kb() {
+	return read_status_kb("VmHWM");
+}
+
+/*!
+ * \brief Resets the peak resident set size to the current one (Linux 4.0+).
+		  If the kernel does not support it, peaks keep growing from process start.
+ */
+void memtrack::reset_rss_peak() {
+	ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+}
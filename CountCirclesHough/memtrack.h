@@ -0,0 +1,36 @@
+#pragma once
+
+#include "globals.h"
+
+/*! \brief Accounted buffer bytes of one detector. */
+struct mem_account {
+	vector<tuple<string, long long, long long>> classes; //!< List of buffer classes; tuple: name,current bytes,peak bytes in the current run
+	long long total = 0; //!< Bytes currently allocated over all classes
+	long long total_peak = 0; //!< Peak of allocated bytes over all classes in the current run
+};
+
+/*!
+ * \brief Accounts bytes of large buffers per buffer class (current and peak within a run, per detector),
+		  and samples the resident set size of the process.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class memtrack
+{
+private:
+	static bool rss_enabled;
+
+	static long long read_status_kb(const string& key);
+
+public:
+	static void begin_run(mem_account& mem);
+	static void alloc(mem_account& mem, const string& name, const long long& bytes);
+	static void release(mem_account& mem, const string& name, const long long& bytes);
+	static long long peak(const mem_account& mem, const string& name);
+	static long long peak_total(const mem_account& mem);
+	static long long current_total(const mem_account& mem);
+	static void enable_rss(const bool& on);
+	static bool rss_is_enabled();
+	static long long rss_peak_kb();
+	static void reset_rss_peak();
+};
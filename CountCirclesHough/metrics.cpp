@@ -0,0 +1,317 @@
+#include "metrics.h"
+#include "trace.h"
+#include "memtrack.h"
+
+/*! \brief All known stages, in pipeline order (fixed CSV column order). */
+const vector<string> metrics::stage_names = {
+	"decode", "grayscale", "blur", "edges",
+	"edge_compaction", "voting", "mpi_send", "mpi_recv", "mpi_merge",
+	"peak_extraction", "spacing", "refinement", "drawing", "hough_total"
+};
+
+/*! \brief All known counters (fixed CSV column order). */
+const vector<string> metrics::counter_names = {
+	"edge_count", "vote_count", "acc_bytes", "merge_bins", "circle_count", "est_vote_count", "est_hough_ns",
+	"mem_src_bytes", "mem_acc_bytes", "mem_rbuf_bytes", "mem_crop_bytes", "mem_peak_bytes", "mem_refused", "acc_hash"
+};
+
+/*! \brief Stages with hardware counters (fixed CSV column order). */
+const vector<string> metrics::perf_stage_names = {
+	"voting", "mpi_merge", "peak_extraction"
+};
+
+/*!
+ * \brief Returns a monotonic timestamp.
+ * \return Timestamp in nanoseconds
+ */
+long long metrics::now() {
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*!
+ * \brief Starts a new run. Drops all counters and all stages except persistent ones
+		  (e.g. preprocessing, which is measured once and shared by repeated hough runs).
+ * \param run Metrics of a run
+ */
+void metrics::begin_run(run_metrics& run) {
+	vector<tuple<string, long long, bool>> kept;
+	for (size_t i = 0; i < run.stages.size(); i++) {
+		if (get<2>(run.stages[i])) {
+			kept.push_back(run.stages[i]);
+		}
+	}
+	run.stages = kept;
+	run.counters.clear();
+	run.perf.clear();
+	run.rss.clear();
+}
+
+/*!
+ * \brief Drops all stages and counters.
+ * \param run Metrics of a run
+ */
+void metrics::clear(run_metrics& run) {
+	run.stages.clear();
+	run.counters.clear();
+	run.perf.clear();
+	run.rss.clear();
+}
+
+/*!
+ * \brief Adds elapsed time to a stage (accumulates if the stage was already recorded in this run).
+		  Must be called right when the stage ends, the stage is also traced as a span ending now.
+		  With resident set size sampling on, records the peak resident set size since the previous stage ended.
+		  Recording takes no lock: every detector records into its own run, from the thread calling it.
+ * \param run Metrics of a run
+ * \param name Stage name
+ * \param ns Elapsed nanoseconds
+ * \param persistent Keep the stage across \link metrics::begin_run \endlink
+ */
+void metrics::add_stage(run_metrics& run, const string& name, const long long& ns, const bool& persistent) {
+	if (trace::is_enabled()) {
+		long long end = now();
+		trace::add(name, end - ns, end);
+	}
+	if (memtrack::rss_is_enabled()) {
+		add_rss(run, name, memtrack::rss_peak_kb());
+		memtrack::reset_rss_peak();
+	}
+
+	for (size_t i = 0; i < run.stages.size(); i++) {
+		if (get<0>(run.stages[i]) == name) {
+			get<1>(run.stages[i]) += ns;
+			return;
+		}
+	}
+	run.stages.push_back(make_tuple(name, ns, persistent));
+}
+
+/*!
+ * \brief Records the peak resident set size of a stage (keeps the maximum if the stage was already recorded in this run).
+ * \param run Metrics of a run
+ * \param name Stage name
+ * \param kb Peak resident set size in kB
+ */
+void metrics::add_rss(run_metrics& run, const string& name, const long long& kb) {
+	for (size_t i = 0; i < run.rss.size(); i++) {
+		if (get<0>(run.rss[i]) == name) {
+			get<1>(run.rss[i]) = max(get<1>(run.rss[i]), kb);
+			return;
+		}
+	}
+	run.rss.push_back(make_tuple(name, kb));
+}
+
+/*!
+ * \brief Adds a value to a counter (accumulates if the counter was already recorded in this run).
+ * \param run Metrics of a run
+ * \param name Counter name
+ * \param value Value to add
+ */
+void metrics::add_counter(run_metrics& run, const string& name, const long long& value) {
+	for (size_t i = 0; i < run.counters.size(); i++) {
+		if (get<0>(run.counters[i]) == name) {
+			get<1>(run.counters[i]) += value;
+			return;
+		}
+	}
+	run.counters.push_back(make_tuple(name, value));
+}
+
+/*!
+ * \brief Adds hardware counter values of a stage on a thread (accumulates per stage and thread).
+		  Samples without any value (counting off) are not recorded. Parallel regions collect
+		  their samples per thread and add them after the region.
+ * \param run Metrics of a run
+ * \param stage Stage name
+ * \param thread OpenMP thread number
+ * \param sample Counter values
+ */
+void metrics::add_perf(run_metrics& run, const string& stage, const int& thread, const perf_sample& sample) {
+	if (sample.cycles < 0 && sample.instructions < 0 && sample.llc_misses < 0 && sample.dtlb_misses < 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < run.perf.size(); i++) {
+		if (get<0>(run.perf[i]) == stage && get<1>(run.perf[i]) == thread) {
+			add_sample(get<2>(run.perf[i]), sample);
+			return;
+		}
+	}
+	run.perf.push_back(make_tuple(stage, thread, sample));
+}
+
+/*!
+ * \brief Adds counter values to a sum, unavailable values (-1) are skipped.
+ * \param sum Sum to add to
+ * \param value Values to add
+ */
+void metrics::add_sample(perf_sample& sum, const perf_sample& value) {
+	long long* s[4] = { &sum.cycles, &sum.instructions, &sum.llc_misses, &sum.dtlb_misses };
+	const long long v[4] = { value.cycles, value.instructions, value.llc_misses, value.dtlb_misses };
+	for (int i = 0; i < 4; i++) {
+		if (v[i] >= 0) {
+			*s[i] = (*s[i] >= 0) ? *s[i] + v[i] : v[i];
+		}
+	}
+}
+
+/*!
+ * \brief Returns the hardware counter values of a stage summed over all threads (-1 = not recorded).
+ * \param run Metrics of a run
+ * \param stage Stage name
+ */
+perf_sample metrics::perf_total(const run_metrics& run, const string& stage) {
+	perf_sample total = { -1, -1, -1, -1 };
+	for (size_t i = 0; i < run.perf.size(); i++) {
+		if (get<0>(run.perf[i]) == stage) {
+			add_sample(total, get<2>(run.perf[i]));
+		}
+	}
+	return total;
+}
+
+long long metrics::find(const vector<tuple<string, long long, bool>>& list, const string& name) {
+	for (size_t i = 0; i < list.size(); i++) {
+		if (get<0>(list[i]) == name) {
+			return get<1>(list[i]);
+		}
+	}
+	return 0;
+}
+
+long long metrics::find(const vector<tuple<string, long long>>& list, const string& name) {
+	for (size_t i = 0; i < list.size(); i++) {
+		if (get<0>(list[i]) == name) {
+			return get<1>(list[i]);
+		}
+	}
+	return 0;
+}
+
+/*!
+ * \brief Returns the elapsed time of a stage in a run (0 if not recorded).
+ * \param run Metrics of a run
+ * \param name Stage name
+ */
+long long metrics::stage(const run_metrics& run, const string& name) {
+	return find(run.stages, name);
+}
+
+/*!
+ * \brief Returns the value of a counter in a run (0 if not recorded).
+ * \param run Metrics of a run
+ * \param name Counter name
+ */
+long long metrics::counter(const run_metrics& run, const string& name) {
+	return find(run.counters, name);
+}
+
+/*!
+ * \brief Returns the metrics file path of an MPI process.
+		  The root process uses the path as given, other processes insert their rank
+		  before the extension (metrics.csv -> metrics.2.csv), so processes never share a file.
+ * \param path Output file path
+ * \param world_rank Process ID of an MPI process
+ */
+string metrics::rank_path(const string& path, const int& world_rank) {
+	if (world_rank == 0) {
+		return path;
+	}
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of('/');
+	if (dot == string::npos || (slash != string::npos && dot < slash)) {
+		return path + "." + to_string(world_rank);
+	}
+	return path.substr(0, dot) + "." + to_string(world_rank) + path.substr(dot);
+}
+
+/*!
+ * \brief Appends a run to a metrics file, as one JSON object per line or one CSV row
+		  (with a header row if the file is new).
+ * \param run Metrics of the run
+ * \param path Output file path
+ * \param format Output format
+ * \param world_rank Process ID of an MPI process
+ * \param run_ind Run index
+ * \param imp_type Implementation type
+ * \param mpi_type MPI field size
+ */
+void metrics::write(const run_metrics& run, const string& path, const MetricsFormat& format, const int& world_rank, const int& run_ind, const ImpType& imp_type, const MpiType& mpi_type) {
+	if (format == MetricsFormat::metrics_none || path.empty()) {
+		return;
+	}
+
+	stringstream line;
+	string file = rank_path(path, world_rank);
+
+	if (format == MetricsFormat::metrics_json) {
+		line << "{\"rank\":" << world_rank << ",\"run\":" << run_ind << ",\"imp\":" << imp_type << ",\"mpi\":" << mpi_type << ",\"stages_ns\":{";
+		for (size_t i = 0; i < stage_names.size(); i++) {
+			line << (i > 0 ? "," : "") << "\"" << stage_names[i] << "\":" << find(run.stages, stage_names[i]);
+		}
+		line << "},\"counters\":{";
+		for (size_t i = 0; i < counter_names.size(); i++) {
+			line << (i > 0 ? "," : "") << "\"" << counter_names[i] << "\":" << find(run.counters, counter_names[i]);
+		}
+		line << "}";
+		if (!run.rss.empty()) {
+			line << ",\"rss_kb\":{";
+			for (size_t i = 0; i < run.rss.size(); i++) {
+				line << (i > 0 ? "," : "") << "\"" << get<0>(run.rss[i]) << "\":" << get<1>(run.rss[i]);
+			}
+			line << "}";
+		}
+		if (!run.perf.empty()) {
+			line << ",\"perf\":[";
+			for (size_t i = 0; i < run.perf.size(); i++) {
+				const perf_sample& p = get<2>(run.perf[i]);
+				line << (i > 0 ? "," : "") << "{\"stage\":\"" << get<0>(run.perf[i]) << "\",\"thread\":" << get<1>(run.perf[i])
+					<< ",\"cycles\":" << p.cycles << ",\"instructions\":" << p.instructions
+					<< ",\"llc_misses\":" << p.llc_misses << ",\"dtlb_misses\":" << p.dtlb_misses << "}";
+			}
+			line << "]";
+		}
+		line << "}\n";
+	}
+	else {
+		ifstream exists(file);
+		if (!exists.good() || exists.peek() == ifstream::traits_type::eof()) {
+			line << "rank,run,imp,mpi";
+			for (size_t i = 0; i < stage_names.size(); i++) {
+				line << "," << stage_names[i] << "_ns";
+			}
+			for (size_t i = 0; i < counter_names.size(); i++) {
+				line << "," << counter_names[i];
+			}
+			for (size_t i = 0; i < stage_names.size(); i++) {
+				line << "," << stage_names[i] << "_rss_kb";
+			}
+			for (size_t i = 0; i < perf_stage_names.size(); i++) {
+				line << "," << perf_stage_names[i] << "_cycles," << perf_stage_names[i] << "_instructions,"
+					<< perf_stage_names[i] << "_llc_misses," << perf_stage_names[i] << "_dtlb_misses";
+			}
+			line << "\n";
+		}
+
+		line << world_rank << "," << run_ind << "," << imp_type << "," << mpi_type;
+		for (size_t i = 0; i < stage_names.size(); i++) {
+			line << "," << find(run.stages, stage_names[i]);
+		}
+		for (size_t i = 0; i < counter_names.size(); i++) {
+			line << "," << find(run.counters, counter_names[i]);
+		}
+		for (size_t i = 0; i < stage_names.size(); i++) {
+			line << "," << find(run.rss, stage_names[i]);
+		}
+		for (size_t i = 0; i < perf_stage_names.size(); i++) {
+			perf_sample p = perf_total(run, perf_stage_names[i]);
+			line << "," << p.cycles << "," << p.instructions << "," << p.llc_misses << "," << p.dtlb_misses;
+		}
+		line << "\n";
+	}
+
+	ofstream out(file, ios_base::app);
+	out << line.str();
+	out.flush();
+}
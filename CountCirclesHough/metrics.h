@@ -0,0 +1,43 @@
+#pragma once
+
+#include "globals.h"
+#include "perfctr.h"
+
+/*! \brief Timings and counters of one pipeline run (owned by one detector, recorded from one thread at a time). */
+struct run_metrics {
+	vector<tuple<string, long long, bool>> stages; //!< List of stages; tuple: name,elapsed nanoseconds,persistent
+	vector<tuple<string, long long>> counters; //!< List of counters; tuple: name,value
+	vector<tuple<string, int, perf_sample>> perf; //!< List of hardware counter values; tuple: stage,thread,values
+	vector<tuple<string, long long>> rss; //!< List of peak resident set sizes; tuple: stage,kB
+};
+
+/*!
+ * \brief Records per-stage timings and counters of a run and exports them as JSON lines or CSV.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class metrics
+{
+private:
+	static const vector<string> stage_names;
+	static const vector<string> counter_names;
+	static const vector<string> perf_stage_names;
+
+	static long long find(const vector<tuple<string, long long, bool>>& list, const string& name);
+	static long long find(const vector<tuple<string, long long>>& list, const string& name);
+	static string rank_path(const string& path, const int& world_rank);
+	static void add_sample(perf_sample& sum, const perf_sample& value);
+	static perf_sample perf_total(const run_metrics& run, const string& stage);
+
+public:
+	static long long now();
+	static void begin_run(run_metrics& run);
+	static void clear(run_metrics& run);
+	static void add_stage(run_metrics& run, const string& name, const long long& ns, const bool& persistent = false);
+	static void add_counter(run_metrics& run, const string& name, const long long& value);
+	static void add_rss(run_metrics& run, const string& name, const long long& kb);
+	static void add_perf(run_metrics& run, const string& stage, const int& thread, const perf_sample& sample);
+	static long long stage(const run_metrics& run, const string& name);
+	static long long counter(const run_metrics& run, const string& name);
+	static void write(const run_metrics& run, const string& path, const MetricsFormat& format, const int& world_rank, const int& run_ind, const ImpType& imp_type, const MpiType& mpi_type);
+};
@@ -0,0 +1,93 @@
+#include "perfctr.h"
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+/*! \brief Hardware counting on/off. */
+bool perfctr::enabled = false;
+
+/*!
+ * \brief Opens one disabled counter for the calling thread on any CPU, excluding kernel and hypervisor.
+ * \param type perf_event type (hardware or hardware cache)
+ * \param config perf_event config
+ * \return File descriptor, -1 if the counter is unavailable (unsupported or not permitted)
+ */
+int perfctr::open_event(const unsigned int& type, const unsigned long long& config) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*!
+ * \brief Turns hardware counting on or off.
+ * \param on Counting on/off
+ */
+void perfctr::enable(const bool& on) {
+	enabled = on;
+}
+
+/*!
+ * \brief Returns whether hardware counting is on.
+ */
+bool perfctr::is_enabled() {
+	return enabled;
+}
+
+/*!
+ * \brief Opens and starts the counters of the calling thread.
+ * \return Open counters, to be passed to \link perfctr::stop \endlink on the same thread
+ */
+perf_group perfctr::start() {
+	perf_group group;
+	for (int i = 0; i < 4; i++) {
+		group.fd[i] = -1;
+	}
+	if (!enabled) {
+		return group;
+	}
+
+	const unsigned long long read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	group.fd[0] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	group.fd[1] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	group.fd[2] = open_event(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss);
+	group.fd[3] = open_event(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | read_miss);
+
+	for (int i = 0; i < 4; i++) {
+		if (group.fd[i] >= 0) {
+			ioctl(group.fd[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(group.fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+	return group;
+}
+
+/*!
+ * \brief Stops and closes the counters of the calling thread.
+ * \param group Counters opened by \link perfctr::start \endlink
+ * \return Counter values (all -1 if counting is off), to be added to a run by \link metrics::add_perf \endlink
+ */
+perf_sample perfctr::stop(perf_group& group) {
+	long long values[4];
+	for (int i = 0; i < 4; i++) {
+		values[i] = -1;
+		if (group.fd[i] >= 0) {
+			ioctl(group.fd[i], PERF_EVENT_IOC_DISABLE, 0);
+			long long count = 0;
+			if (read(group.fd[i], &count, sizeof(count)) == sizeof(count)) {
+				values[i] = count;
+			}
+			close(group.fd[i]);
+			group.fd[i] = -1;
+		}
+	}
+
+	perf_sample sample = { values[0], values[1], values[2], values[3] };
+	return sample;
+}
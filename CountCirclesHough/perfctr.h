@@ -0,0 +1,36 @@
+#pragma once
+
+#include "globals.h"
+
+/*! \brief Hardware counter values of one stage on one thread (-1 = counter unavailable). */
+struct perf_sample {
+	long long cycles; //!< CPU cycles
+	long long instructions; //!< Retired instructions
+	long long llc_misses; //!< Last level cache read misses
+	long long dtlb_misses; //!< Data TLB read misses
+};
+
+/*! \brief Open hardware counters of the calling thread. */
+struct perf_group {
+	int fd[4]; //!< perf_event file descriptors: cycles, instructions, llc misses, dtlb misses (-1 = not open)
+};
+
+/*!
+ * \brief Optional per-thread hardware performance counters (Linux perf_event_open, user space only).
+		  Counting is off by default; when off, start and stop do nothing.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class perfctr
+{
+private:
+	static bool enabled;
+
+	static int open_event(const unsigned int& type, const unsigned long long& config);
+
+public:
+	static void enable(const bool& on);
+	static bool is_enabled();
+	static perf_group start();
+	static perf_sample stop(perf_group& group);
+};
@@ -0,0 +1,156 @@
+#include "planner.h"
+
+/*!
+ * \brief Returns the default runtime model (rough values of a current desktop CPU).
+ */
+plan_model planner::default_model() {
+	return { 1.5, 0.05, 0.3, 1.0, 0.8 };
+}
+
+/*!
+ * \brief Parses a runtime model from a comma-separated list: vote_ns,byte_ns,comm_ns,merge_ns,omp_eff.
+		  Missing or empty entries keep their default value.
+ * \param list Comma-separated list
+ */
+plan_model planner::parse_model(const string& list) {
+	plan_model model = default_model();
+	double* fields[5] = { &model.vote_ns, &model.byte_ns, &model.comm_ns, &model.merge_ns, &model.omp_eff };
+	stringstream ss(list);
+	string item;
+	for (int i = 0; i < 5 && getline(ss, item, ','); i++) {
+		if (!item.empty()) {
+			*fields[i] = stod(item);
+		}
+	}
+	return model;
+}
+
+/*!
+ * \brief Predicts work and runtime of every implementation type available to this launch
+		  (sequential and OpenMP always, OpenMPI full, crop and rows with at least 2 MPI processes).
+		  MPI workers vote in parallel (each with omp_threads threads), the root receives and merges one accumulator after another.
+		  Memory is that of the largest process, as allocated by the transformation itself.
+		  MPI full workers send their occupancy bitmap and occupied runs only; their occupancy is estimated from
+		  an equal share of edge pixels scattered uniformly over the accumulator. Real edges cluster and share
+		  more blocks, so occupied runs are rather overestimated (mpi full is not favoured by it).
+ * \param w Workload of the edge image
+ * \param width Image width
+ * \param height Image height
+ * \param min_radius Minimum circle radius
+ * \param max_radius Maximum circle radius
+ * \param world_size Number of all MPI processes (0 or 1 = no MPI)
+ * \param omp_threads Number of OpenMP threads
+ * \param model Runtime model
+ * \return Estimates, one per implementation type
+ */
+vector<plan_estimate> planner::estimate(
+	const hough_workload& w,
+	const int& width,
+	const int& height,
+	const int& min_radius,
+	const int& max_radius,
+	const int& world_size,
+	const int& omp_threads,
+	const plan_model& model) {
+
+	vector<plan_estimate> estimates;
+	long long votes = (long long)w.edge_cnt * w.stencil_size;
+	long long acc_d = max_radius - min_radius + 1;
+	long long acc_cells = (long long)width * height * acc_d;
+
+	//sequential, openmp: one accumulator, no communication
+	long long mem = hough::largest_process_bytes(ImpType::sequential, MpiType::full, width, height, min_radius, max_radius, 1, w.acc_elem_size);
+	estimates.push_back({ ImpType::sequential, MpiType::full, votes, mem, 0,
+		votes * model.vote_ns + mem * model.byte_ns });
+	estimates.push_back({ ImpType::openmp, MpiType::full, votes, mem, 0,
+		votes * model.vote_ns / max(1.0, omp_threads * model.omp_eff) + mem * model.byte_ns });
+
+	if (world_size < 2) {
+		return estimates;
+	}
+
+	int workers = world_size - 1;
+	long long image_bytes = (long long)width * height;
+	double vote_ns = votes * model.vote_ns / (workers * max(1.0, omp_threads * model.omp_eff));
+
+	//mpi full: every process holds a full accumulator, the root also a receive buffer, every worker sends its occupancy bitmap
+	//and its occupied runs, which the root merges
+	long long blocks = (acc_cells + hough::occ_block - 1) / hough::occ_block;
+	double worker_blocks = blocks * (1.0 - exp(-((double)w.edge_cnt / workers) * w.occ_blocks / max(1LL, blocks)));
+	long long run_bins = min(acc_cells, (long long)(worker_blocks * hough::occ_block));
+	long long bitmap_bytes = ((blocks + 63) / 64) * (long long)sizeof(unsigned long long);
+	long long full_comm = image_bytes * workers + (bitmap_bytes + run_bins * w.acc_elem_size) * workers;
+	mem = hough::largest_process_bytes(ImpType::openmpi, MpiType::full, width, height, min_radius, max_radius, world_size, w.acc_elem_size);
+	estimates.push_back({ ImpType::openmpi, MpiType::full, votes, mem, full_comm,
+		vote_ns + mem * model.byte_ns + full_comm * model.comm_ns + run_bins * workers * model.merge_ns });
+
+	//mpi crop/rows: vertical/horizontal stripes, every stripe accumulator is widened by max_radius on both sides,
+	//the root receives them in place (each after its occupancy bitmap) and only buffers the overlap band of neighbouring stripes
+	for (int m = 0; m < 2; m++) {
+		MpiType mpi_type = (m == 0) ? MpiType::crop : MpiType::rows;
+		int len = (mpi_type == MpiType::rows) ? height : width;
+		int side = (mpi_type == MpiType::rows) ? width : height;
+		int roi_shift = len / workers;
+		long long crop_cells = 0, crop_bitmap_bytes = 0;
+		for (int i = 0; i < workers; i++) {
+			int roi_len = (i == workers - 1) ? len - roi_shift * i : roi_shift;
+			long long cells = (long long)(roi_len + 2 * max_radius) * side * acc_d;
+			crop_cells += cells;
+			crop_bitmap_bytes += (((cells + hough::occ_block - 1) / hough::occ_block + 63) / 64) * (long long)sizeof(unsigned long long);
+		}
+		long long band_cells = (workers > 1) ? (long long)(2 * max_radius) * side * acc_d : 0;
+		long long crop_comm = image_bytes + crop_bitmap_bytes + crop_cells * w.acc_elem_size;
+		mem = hough::largest_process_bytes(ImpType::openmpi, mpi_type, width, height, min_radius, max_radius, world_size, w.acc_elem_size);
+		estimates.push_back({ ImpType::openmpi, mpi_type, votes, mem, crop_comm,
+			vote_ns + mem * model.byte_ns + crop_comm * model.comm_ns + 2 * band_cells * (workers - 1) * model.merge_ns });
+	}
+
+	return estimates;
+}
+
+/*!
+ * \brief Picks the predicted-fastest implementation type. The OpenMPI types are only picked by a launch
+		  with MPI processes; such a launch may still pick sequential or OpenMP (workers then stay idle).
+ * \param estimates Estimates of all implementation types
+ * \param use_mpi Launched with MPI processes
+ * \return Fastest estimate
+ */
+plan_estimate planner::select(const vector<plan_estimate>& estimates, const bool& use_mpi) {
+	plan_estimate best = estimates[0];
+	bool found = false;
+	for (size_t i = 0; i < estimates.size(); i++) {
+		if ((use_mpi || estimates[i].imp_type != ImpType::openmpi) && (!found || estimates[i].ns < best.ns)) {
+			best = estimates[i];
+			found = true;
+		}
+	}
+	return best;
+}
+
+/*!
+ * \brief Returns the estimate of an implementation type (the first estimate if it was not estimated).
+ * \param estimates Estimates of all implementation types
+ * \param imp_type Implementation type
+ * \param mpi_type MPI field size
+ */
+plan_estimate planner::find(const vector<plan_estimate>& estimates, const ImpType& imp_type, const MpiType& mpi_type) {
+	for (size_t i = 0; i < estimates.size(); i++) {
+		if (estimates[i].imp_type == imp_type && (imp_type != ImpType::openmpi || estimates[i].mpi_type == mpi_type)) {
+			return estimates[i];
+		}
+	}
+	return estimates[0];
+}
+
+/*!
+ * \brief Prints all estimates to the console.
+ * \param estimates Estimates of all implementation types
+ * \param world_rank Process ID of an MPI process
+ */
+void planner::print(const vector<plan_estimate>& estimates, const int& world_rank) {
+	for (size_t i = 0; i < estimates.size(); i++) {
+		cout << world_rank << " plan: imp: " << estimates[i].imp_type << " mpi: " << estimates[i].mpi_type
+			<< " votes: " << estimates[i].votes << " mem bytes: " << estimates[i].mem_bytes
+			<< " comm bytes: " << estimates[i].comm_bytes << " estimated: " << (estimates[i].ns / 1000000.0) << "ms" << endl;
+	}
+}
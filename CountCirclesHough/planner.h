@@ -0,0 +1,48 @@
+#pragma once
+
+#include "globals.h"
+#include "hough.h"
+
+/*! \brief Cost coefficients of the runtime model (calibrate on the target machine). */
+struct plan_model {
+	double vote_ns; //!< Nanoseconds per vote on one thread
+	double byte_ns; //!< Nanoseconds per byte of the largest process (allocation, zeroing, peak scan)
+	double comm_ns; //!< Nanoseconds per byte sent or received by the MPI root
+	double merge_ns; //!< Nanoseconds per accumulator bin merged on the MPI root
+	double omp_eff; //!< Parallel efficiency of OpenMP voting (0-1)
+};
+
+/*! \brief Predicted work and runtime of one implementation type. */
+struct plan_estimate {
+	ImpType imp_type; //!< Implementation type
+	MpiType mpi_type; //!< MPI field size (openmpi only)
+	long long votes; //!< Expected votes (edge pixels * stencil offsets, ignoring border clipping)
+	long long mem_bytes; //!< Image and accumulator memory of the largest process in bytes (see hough::largest_process_bytes)
+	long long comm_bytes; //!< Bytes sent and received by the MPI root (mpi full: expected occupied runs only)
+	double ns; //!< Predicted hough runtime in nanoseconds
+};
+
+/*!
+ * \brief Predicts the work and runtime of every implementation type from the workload of an edge image
+		  and picks the predicted-fastest one.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class planner
+{
+public:
+	static plan_model default_model();
+	static plan_model parse_model(const string& list);
+	static vector<plan_estimate> estimate(
+		const hough_workload& w,
+		const int& width,
+		const int& height,
+		const int& min_radius,
+		const int& max_radius,
+		const int& world_size,
+		const int& omp_threads,
+		const plan_model& model);
+	static plan_estimate select(const vector<plan_estimate>& estimates, const bool& use_mpi);
+	static plan_estimate find(const vector<plan_estimate>& estimates, const ImpType& imp_type, const MpiType& mpi_type);
+	static void print(const vector<plan_estimate>& estimates, const int& world_rank);
+};
@@ -0,0 +1,110 @@
+#!/bin/bash
+#
+# Thread and rank scaling study of CountCirclesHough.
+#
+# Sweeps OpenMP thread counts (imp=1), and MPI process counts times OpenMP threads per process
+# (imp=2, mpi=0 full, mpi=1 crop and mpi=2 rows) on one image, runs every point in evaluation mode
+# and reads the hough runtimes from the per-run metrics output of the root process.
+# The first run of every point is a warmup and is dropped.
+# Speedup is relative to the sequential implementation (imp=0), parallel efficiency is
+# speedup / (threads * processes).
+#
+# Usage:
+#   ./scaling.sh [-t "1 2 4 8"] [-n "2 3 5"] [-r 10] [-o scaling.csv] <image> [-- <CountCirclesHough parameters>]
+# Example:
+#   ./scaling.sh -t "1 2 4" -n "2 3 5 9" -r 10 images/money2.png -- -min-radius=25 -max-radius=35 -peak-tresh=135
+# Environment:
+#   MPIEXEC        MPI launcher (default: mpiexec)
+#   MPIEXEC_FLAGS  extra launcher flags, e.g. "--oversubscribe" (OpenMPI) when ranks exceed cores
+#   HOUGH_BIN      program to run (default: CountCirclesHough next to this script)
+#
+# \copyright MIT License
+# \author 97131004
+
+set -e
+
+threads="1 2 4"
+ranks="2 3 5"
+runs=10
+out="scaling.csv"
+mpiexec=${MPIEXEC:-mpiexec}
+
+while getopts "t:n:r:o:" opt; do
+	case $opt in
+		t) threads=$OPTARG ;;
+		n) ranks=$OPTARG ;;
+		r) runs=$OPTARG ;;
+		o) out=$OPTARG ;;
+		*) sed -n '2,22p' "$0"; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -lt 1 ] || [ $runs -lt 2 ]; then
+	sed -n '2,22p' "$0"
+	exit 1
+fi
+
+img=$(realpath "$1")
+shift
+[ "$1" == "--" ] && shift
+extra=("$@")
+
+bin=$(realpath "${HOUGH_BIN:-$(dirname "$0")/CountCirclesHough}")
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# run_point <label> <imp> <mpi> <threads> <processes>: runs one configuration,
+# prints "<median_ns> <min_ns> <max_ns>" of hough_total over all runs but the first
+run_point() {
+	local imp=$2 mpi=$3 t=$4 np=$5
+	local metrics="$work/$1.csv"
+	local cmd=("$bin" "$img" -gui=0 -eval-times=$runs -imp=$imp -mpi=$mpi -omp-threads=$t -metrics="$metrics" -metrics-format=2 "${extra[@]}")
+
+	if [ $imp -eq 2 ]; then
+		(cd "$work" && $mpiexec $MPIEXEC_FLAGS -n $np "${cmd[@]}" > "$work/$1.log" 2>&1)
+	else
+		(cd "$work" && "${cmd[@]}" > "$work/$1.log" 2>&1)
+	fi
+
+	awk -F, '
+		NR == 1 { for (i = 1; i <= NF; i++) if ($i == "hough_total_ns") col = i; next }
+		$2 > 0 { print $col }' "$metrics" | sort -n | awk '
+		{ v[NR] = $1 }
+		END { if (NR == 0) print "0 0 0"; else print v[int((NR + 1) / 2)], v[1], v[NR] }'
+}
+
+echo "label,imp,mpi,threads,processes,runs,median_ms,min_ms,max_ms,speedup,efficiency" > "$out"
+
+# add_row <label> <imp> <mpi> <threads> <processes>
+add_row() {
+	read -r median min max <<< "$(run_point "$@")"
+	if [ -z "$base" ]; then
+		base=$median
+	fi
+	awk -v l="$1" -v imp=$2 -v mpi=$3 -v t=$4 -v np=$5 -v runs=$((runs - 1)) -v med=$median -v mn=$min -v mx=$max -v base=$base 'BEGIN {
+		speedup = med > 0 ? base / med : 0
+		printf "%s,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f\n", l, imp, mpi, t, np, runs, med / 1e6, mn / 1e6, mx / 1e6, speedup, speedup / (t * np)
+	}' >> "$out"
+}
+
+base=""
+add_row seq 0 0 1 1
+
+for t in $threads; do
+	add_row omp_t$t 1 0 $t 1
+done
+
+for np in $ranks; do
+	for t in $threads; do
+		add_row mpi_full_n${np}_t$t 2 0 $t $np
+		add_row mpi_crop_n${np}_t$t 2 1 $t $np
+		add_row mpi_rows_n${np}_t$t 2 2 $t $np
+	done
+done
+
+if command -v column > /dev/null; then
+	column -s, -t < "$out"
+else
+	cat "$out"
+fi
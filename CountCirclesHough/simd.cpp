@@ -0,0 +1,413 @@
+#include "simd.h"
+#include <immintrin.h>
+
+#pragma region intrinsic helpers
+
+//unsigned max and broadcast per counter type, selected by overloading on the element type
+
+__attribute__((target("avx2"))) static inline __m256i max256(__m256i a, __m256i b, uchar) { return _mm256_max_epu8(a, b); }
+__attribute__((target("avx2"))) static inline __m256i max256(__m256i a, __m256i b, ushort) { return _mm256_max_epu16(a, b); }
+__attribute__((target("avx2"))) static inline __m256i max256(__m256i a, __m256i b, uint) { return _mm256_max_epu32(a, b); }
+__attribute__((target("avx2"))) static inline __m256i eq256(__m256i a, __m256i b, uchar) { return _mm256_cmpeq_epi8(a, b); }
+__attribute__((target("avx2"))) static inline __m256i eq256(__m256i a, __m256i b, ushort) { return _mm256_cmpeq_epi16(a, b); }
+__attribute__((target("avx2"))) static inline __m256i eq256(__m256i a, __m256i b, uint) { return _mm256_cmpeq_epi32(a, b); }
+__attribute__((target("avx2"))) static inline __m256i set256(uchar v) { return _mm256_set1_epi8((char)v); }
+__attribute__((target("avx2"))) static inline __m256i set256(ushort v) { return _mm256_set1_epi16((short)v); }
+__attribute__((target("avx2"))) static inline __m256i set256(uint v) { return _mm256_set1_epi32((int)v); }
+
+__attribute__((target("avx512f,avx512bw"))) static inline __m512i set512(uchar v) { return _mm512_set1_epi8((char)v); }
+__attribute__((target("avx512f,avx512bw"))) static inline __m512i set512(ushort v) { return _mm512_set1_epi16((short)v); }
+__attribute__((target("avx512f,avx512bw"))) static inline __m512i set512(uint v) { return _mm512_set1_epi32((int)v); }
+__attribute__((target("avx512f,avx512bw"))) static inline bool any_ge512(__m512i a, __m512i b, uchar) { return _mm512_cmpge_epu8_mask(a, b) != 0; }
+__attribute__((target("avx512f,avx512bw"))) static inline bool any_ge512(__m512i a, __m512i b, ushort) { return _mm512_cmpge_epu16_mask(a, b) != 0; }
+__attribute__((target("avx512f,avx512bw"))) static inline bool any_ge512(__m512i a, __m512i b, uint) { return _mm512_cmpge_epu32_mask(a, b) != 0; }
+
+//saturating unsigned add per counter type (32-bit has no saturating instruction: a wrapped sum is smaller than an addend)
+
+__attribute__((target("avx2"))) static inline __m256i adds256(__m256i a, __m256i b, uchar) { return _mm256_adds_epu8(a, b); }
+__attribute__((target("avx2"))) static inline __m256i adds256(__m256i a, __m256i b, ushort) { return _mm256_adds_epu16(a, b); }
+__attribute__((target("avx2"))) static inline __m256i adds256(__m256i a, __m256i b, uint) {
+	__m256i s = _mm256_add_epi32(a, b);
+	__m256i ok = _mm256_cmpeq_epi32(_mm256_max_epu32(s, a), s);
+	return _mm256_or_si256(s, _mm256_andnot_si256(ok, _mm256_set1_epi32(-1)));
+}
+__attribute__((target("avx512f,avx512bw"))) static inline __m512i adds512(__m512i a, __m512i b, uchar) { return _mm512_adds_epu8(a, b); }
+__attribute__((target("avx512f,avx512bw"))) static inline __m512i adds512(__m512i a, __m512i b, ushort) { return _mm512_adds_epu16(a, b); }
+__attribute__((target("avx512f,avx512bw"))) static inline __m512i adds512(__m512i a, __m512i b, uint) {
+	__m512i s = _mm512_add_epi32(a, b);
+	return _mm512_mask_mov_epi32(s, _mm512_cmplt_epu32_mask(s, a), _mm512_set1_epi32(-1));
+}
+
+#pragma endregion
+
+/*!
+ * \brief Detects the widest instruction set supported by the running CPU.
+ * \return Widest supported SIMD type
+ */
+SimdType simd::detect() {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+		return SimdType::simd_avx512;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return SimdType::simd_avx2;
+	}
+	return SimdType::simd_scalar;
+}
+
+/*!
+ * \brief Resolves a requested SIMD type to one supported by the running CPU.
+ * \param requested Requested SIMD type (simd_auto picks the widest available)
+ * \return SIMD type to run
+ */
+SimdType simd::resolve(const SimdType& requested) {
+	SimdType widest = detect();
+	if (requested == SimdType::simd_auto || requested > widest) {
+		return widest;
+	}
+	return requested;
+}
+
+/*!
+ * \brief Returns a printable name of a SIMD type.
+ * \param simd_type SIMD type
+ */
+const char* simd::name(const SimdType& simd_type) {
+	switch (simd_type) {
+	case SimdType::simd_avx2: return "avx2";
+	case SimdType::simd_avx512: return "avx512";
+	case SimdType::simd_auto: return "auto";
+	default: return "scalar";
+	}
+}
+
+#pragma region edge pixel detection
+
+/*!
+ * \brief Collects X-indices of all edge pixels (255 = white) of an image row.
+ * \param row Image row
+ * \param x1 Start X-index
+ * \param x2 End X-index (exclusive)
+ * \param xs Output X-indices (must hold x2 - x1 entries)
+ * \param simd_type SIMD type to run
+ * \return Number of edge pixels found
+ */
+int simd::find_edges(const uchar* row, const int& x1, const int& x2, int* xs, const SimdType& simd_type) {
+	if (simd_type == SimdType::simd_avx512) {
+		return find_edges_avx512(row, x1, x2, xs);
+	}
+	if (simd_type == SimdType::simd_avx2) {
+		return find_edges_avx2(row, x1, x2, xs);
+	}
+	return find_edges_scalar(row, x1, x2, xs);
+}
+
+int simd::find_edges_scalar(const uchar* row, const int& x1, const int& x2, int* xs) {
+	int cnt = 0;
+	for (int i = x1; i < x2; i++) {
+		if (row[i] == 255) {
+			xs[cnt++] = i;
+		}
+	}
+	return cnt;
+}
+
+__attribute__((target("avx2")))
+int simd::find_edges_avx2(const uchar* row, const int& x1, const int& x2, int* xs) {
+	int cnt = 0;
+	int i = x1;
+	const __m256i white = _mm256_set1_epi8((char)255);
+
+	for (; i + 32 <= x2; i += 32) {
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(row + i)), white));
+		while (mask) {
+			xs[cnt++] = i + __builtin_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+	return cnt + find_edges_scalar(row, i, x2, xs + cnt);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+int simd::find_edges_avx512(const uchar* row, const int& x1, const int& x2, int* xs) {
+	int cnt = 0;
+	int i = x1;
+	const __m512i white = _mm512_set1_epi8((char)255);
+
+	for (; i + 64 <= x2; i += 64) {
+		unsigned long long mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)(row + i)), white);
+		while (mask) {
+			xs[cnt++] = i + __builtin_ctzll(mask);
+			mask &= mask - 1;
+		}
+	}
+	return cnt + find_edges_scalar(row, i, x2, xs + cnt);
+}
+
+#pragma endregion
+
+#pragma region voting offset generation
+
+/*!
+ * \brief Generates integer voting offsets of one radius for every angle from Q16 fixed-point trig tables:
+		  round(-r * cos(t)), round(-r * sin(t)), rounded to nearest with ties away from zero, so the stencil is
+		  symmetric (no bias towards any direction). Integer-only, so every SIMD width gives identical offsets.
+ * \param cos_q Cosine table (Q16)
+ * \param sin_q Sine table (Q16)
+ * \param cnt Number of angles
+ * \param r Radius (below 32768)
+ * \param dx Output X-offsets (cnt entries)
+ * \param dy Output Y-offsets (cnt entries)
+ * \param simd_type SIMD type to run
+ */
+void simd::radius_offsets(const int* cos_q, const int* sin_q, const int& cnt, const int& r, int* dx, int* dy, const SimdType& simd_type) {
+	if (simd_type == SimdType::simd_avx512) {
+		radius_offsets_avx512(cos_q, sin_q, cnt, r, dx, dy);
+	}
+	else if (simd_type == SimdType::simd_avx2) {
+		radius_offsets_avx2(cos_q, sin_q, cnt, r, dx, dy);
+	}
+	else {
+		radius_offsets_scalar(cos_q, sin_q, cnt, r, dx, dy);
+	}
+}
+
+void simd::radius_offsets_scalar(const int* cos_q, const int* sin_q, const int& cnt, const int& r, int* dx, int* dy) {
+	for (int t = 0; t < cnt; t++) {
+		int x = -r * cos_q[t];
+		int y = -r * sin_q[t];
+		dx[t] = (x < 0) ? -((-x + (1 << 15)) >> 16) : (x + (1 << 15)) >> 16;
+		dy[t] = (y < 0) ? -((-y + (1 << 15)) >> 16) : (y + (1 << 15)) >> 16;
+	}
+}
+
+__attribute__((target("avx2")))
+void simd::radius_offsets_avx2(const int* cos_q, const int* sin_q, const int& cnt, const int& r, int* dx, int* dy) {
+	int t = 0;
+	const __m256i neg_r = _mm256_set1_epi32(-r);
+	const __m256i half = _mm256_set1_epi32(1 << 15);
+
+	//|v| rounded and shifted, then the sign of v restored (sign_epi32 negates lanes where v < 0)
+	for (; t + 8 <= cnt; t += 8) {
+		__m256i x = _mm256_mullo_epi32(neg_r, _mm256_loadu_si256((const __m256i*)(cos_q + t)));
+		__m256i y = _mm256_mullo_epi32(neg_r, _mm256_loadu_si256((const __m256i*)(sin_q + t)));
+		__m256i qx = _mm256_srli_epi32(_mm256_add_epi32(_mm256_abs_epi32(x), half), 16);
+		__m256i qy = _mm256_srli_epi32(_mm256_add_epi32(_mm256_abs_epi32(y), half), 16);
+		_mm256_storeu_si256((__m256i*)(dx + t), _mm256_sign_epi32(qx, x));
+		_mm256_storeu_si256((__m256i*)(dy + t), _mm256_sign_epi32(qy, y));
+	}
+	radius_offsets_scalar(cos_q + t, sin_q + t, cnt - t, r, dx + t, dy + t);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void simd::radius_offsets_avx512(const int* cos_q, const int* sin_q, const int& cnt, const int& r, int* dx, int* dy) {
+	int t = 0;
+	const __m512i neg_r = _mm512_set1_epi32(-r);
+	const __m512i half = _mm512_set1_epi32(1 << 15);
+	const __m512i zero = _mm512_setzero_si512();
+
+	for (; t + 16 <= cnt; t += 16) {
+		__m512i x = _mm512_mullo_epi32(neg_r, _mm512_loadu_si512((const void*)(cos_q + t)));
+		__m512i y = _mm512_mullo_epi32(neg_r, _mm512_loadu_si512((const void*)(sin_q + t)));
+		__m512i qx = _mm512_srli_epi32(_mm512_add_epi32(_mm512_abs_epi32(x), half), 16);
+		__m512i qy = _mm512_srli_epi32(_mm512_add_epi32(_mm512_abs_epi32(y), half), 16);
+		_mm512_storeu_si512((void*)(dx + t), _mm512_mask_sub_epi32(qx, _mm512_cmplt_epi32_mask(x, zero), zero, qx));
+		_mm512_storeu_si512((void*)(dy + t), _mm512_mask_sub_epi32(qy, _mm512_cmplt_epi32_mask(y, zero), zero, qy));
+	}
+	radius_offsets_scalar(cos_q + t, sin_q + t, cnt - t, r, dx + t, dy + t);
+}
+
+#pragma endregion
+
+#pragma region accumulator scans
+
+/*!
+ * \brief Checks whether any counter of a contiguous run reaches a treshold.
+ * \tparam T Accumulator counter type
+ * \param p Run start
+ * \param n Run length
+ * \param tresh Treshold
+ * \param simd_type SIMD type to run
+ */
+template <typename T>
+bool simd::any_ge(const T* p, const int& n, const int& tresh, const SimdType& simd_type) {
+	//compared in long long, (int) of the 32-bit maximum would be -1
+	if (n <= 0 || (long long)tresh > (long long)numeric_limits<T>::max()) {
+		return false;
+	}
+	if (tresh <= 0) {
+		return true;
+	}
+	if (simd_type == SimdType::simd_avx512) {
+		return any_ge_avx512(p, n, (T)tresh);
+	}
+	if (simd_type == SimdType::simd_avx2) {
+		return any_ge_avx2(p, n, (T)tresh);
+	}
+	return any_ge_scalar(p, n, (T)tresh);
+}
+
+template <typename T>
+bool simd::any_ge_scalar(const T* p, const int& n, const T& tresh) {
+	for (int i = 0; i < n; i++) {
+		if (p[i] >= tresh) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+bool simd::any_ge_avx2(const T* p, const int& n, const T& tresh) {
+	const int lanes = 32 / sizeof(T);
+	int i = 0;
+	const __m256i t = set256(tresh);
+
+	//x >= t <=> max(x, t) == x, tested on whole registers
+	for (; i + lanes <= n; i += lanes) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(p + i));
+		if (_mm256_movemask_epi8(eq256(max256(x, t, T()), x, T())) != 0) {
+			return true;
+		}
+	}
+	return any_ge_scalar(p + i, n - i, tresh);
+}
+
+template <typename T>
+__attribute__((target("avx512f,avx512bw")))
+bool simd::any_ge_avx512(const T* p, const int& n, const T& tresh) {
+	const int lanes = 64 / sizeof(T);
+	int i = 0;
+	const __m512i t = set512(tresh);
+
+	for (; i + lanes <= n; i += lanes) {
+		if (any_ge512(_mm512_loadu_si512((const void*)(p + i)), t, T())) {
+			return true;
+		}
+	}
+	return any_ge_scalar(p + i, n - i, tresh);
+}
+
+template bool simd::any_ge<uchar>(const uchar* p, const int& n, const int& tresh, const SimdType& simd_type);
+template bool simd::any_ge<ushort>(const ushort* p, const int& n, const int& tresh, const SimdType& simd_type);
+template bool simd::any_ge<uint>(const uint* p, const int& n, const int& tresh, const SimdType& simd_type);
+
+#pragma endregion
+
+#pragma region accumulator merge
+
+/*!
+ * \brief Adds a contiguous run of accumulator counters onto another one, saturating at the counter maximum
+		  (same result as hough::acc_add per counter).
+ * \tparam T Accumulator counter type
+ * \param dst Run to add onto
+ * \param src Run to add
+ * \param n Run length
+ * \param simd_type SIMD type to run
+ */
+template <typename T>
+void simd::add_sat(T* dst, const T* src, const int& n, const SimdType& simd_type) {
+	if (simd_type == SimdType::simd_avx512) {
+		add_sat_avx512(dst, src, n);
+	}
+	else if (simd_type == SimdType::simd_avx2) {
+		add_sat_avx2(dst, src, n);
+	}
+	else {
+		add_sat_scalar(dst, src, n);
+	}
+}
+
+template <typename T>
+void simd::add_sat_scalar(T* dst, const T* src, const int& n) {
+	for (int i = 0; i < n; i++) {
+		dst[i] = (dst[i] > numeric_limits<T>::max() - src[i]) ? numeric_limits<T>::max() : dst[i] + src[i];
+	}
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+void simd::add_sat_avx2(T* dst, const T* src, const int& n) {
+	const int lanes = 32 / sizeof(T);
+	int i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		d = adds256(d, _mm256_loadu_si256((const __m256i*)(src + i)), T());
+		_mm256_storeu_si256((__m256i*)(dst + i), d);
+	}
+	add_sat_scalar(dst + i, src + i, n - i);
+}
+
+template <typename T>
+__attribute__((target("avx512f,avx512bw")))
+void simd::add_sat_avx512(T* dst, const T* src, const int& n) {
+	const int lanes = 64 / sizeof(T);
+	int i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		__m512i d = _mm512_loadu_si512((const void*)(dst + i));
+		d = adds512(d, _mm512_loadu_si512((const void*)(src + i)), T());
+		_mm512_storeu_si512((void*)(dst + i), d);
+	}
+	add_sat_scalar(dst + i, src + i, n - i);
+}
+
+template void simd::add_sat<uchar>(uchar* dst, const uchar* src, const int& n, const SimdType& simd_type);
+template void simd::add_sat<ushort>(ushort* dst, const ushort* src, const int& n, const SimdType& simd_type);
+template void simd::add_sat<uint>(uint* dst, const uint* src, const int& n, const SimdType& simd_type);
+
+#pragma endregion
+
+#pragma region histogram updates
+
+/*!
+ * \brief Slides a 16-bit histogram: adds one histogram and subtracts another, bin by bin (dst += add - sub).
+ * \param dst Histogram to update
+ * \param add Histogram to add
+ * \param sub Histogram to subtract
+ * \param n Number of bins
+ * \param simd_type SIMD type to run
+ */
+void simd::hist_update(ushort* dst, const ushort* add, const ushort* sub, const int& n, const SimdType& simd_type) {
+	if (simd_type == SimdType::simd_avx512) {
+		hist_update_avx512(dst, add, sub, n);
+	}
+	else if (simd_type == SimdType::simd_avx2) {
+		hist_update_avx2(dst, add, sub, n);
+	}
+	else {
+		hist_update_scalar(dst, add, sub, n);
+	}
+}
+
+void simd::hist_update_scalar(ushort* dst, const ushort* add, const ushort* sub, const int& n) {
+	for (int i = 0; i < n; i++) {
+		dst[i] = (ushort)(dst[i] + add[i] - sub[i]);
+	}
+}
+
+__attribute__((target("avx2")))
+void simd::hist_update_avx2(ushort* dst, const ushort* add, const ushort* sub, const int& n) {
+	int i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		d = _mm256_add_epi16(d, _mm256_loadu_si256((const __m256i*)(add + i)));
+		d = _mm256_sub_epi16(d, _mm256_loadu_si256((const __m256i*)(sub + i)));
+		_mm256_storeu_si256((__m256i*)(dst + i), d);
+	}
+	hist_update_scalar(dst + i, add + i, sub + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void simd::hist_update_avx512(ushort* dst, const ushort* add, const ushort* sub, const int& n) {
+	int i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m512i d = _mm512_loadu_si512((const void*)(dst + i));
+		d = _mm512_add_epi16(d, _mm512_loadu_si512((const void*)(add + i)));
+		d = _mm512_sub_epi16(d, _mm512_loadu_si512((const void*)(sub + i)));
+		_mm512_storeu_si512((void*)(dst + i), d);
+	}
+	hist_update_scalar(dst + i, add + i, sub + i, n - i);
+}
+
+#pragma endregion
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "globals.h"
+
+/*!
+ * \brief Collection of vectorized kernels with runtime CPU feature dispatch.
+		  Every kernel has a scalar fallback producing identical results.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class simd
+{
+private:
+	static int find_edges_scalar(const uchar* row, const int& x1, const int& x2, int* xs);
+	static int find_edges_avx2(const uchar* row, const int& x1, const int& x2, int* xs);
+	static int find_edges_avx512(const uchar* row, const int& x1, const int& x2, int* xs);
+
+	static void radius_offsets_scalar(const int* cos_q, const int* sin_q, const int& cnt, const int& r, int* dx, int* dy);
+	static void radius_offsets_avx2(const int* cos_q, const int* sin_q, const int& cnt, const int& r, int* dx, int* dy);
+	static void radius_offsets_avx512(const int* cos_q, const int* sin_q, const int& cnt, const int& r, int* dx, int* dy);
+
+	template <typename T> static bool any_ge_scalar(const T* p, const int& n, const T& tresh);
+	template <typename T> static bool any_ge_avx2(const T* p, const int& n, const T& tresh);
+	template <typename T> static bool any_ge_avx512(const T* p, const int& n, const T& tresh);
+
+	template <typename T> static void add_sat_scalar(T* dst, const T* src, const int& n);
+	template <typename T> static void add_sat_avx2(T* dst, const T* src, const int& n);
+	template <typename T> static void add_sat_avx512(T* dst, const T* src, const int& n);
+
+	static void hist_update_scalar(ushort* dst, const ushort* add, const ushort* sub, const int& n);
+	static void hist_update_avx2(ushort* dst, const ushort* add, const ushort* sub, const int& n);
+	static void hist_update_avx512(ushort* dst, const ushort* add, const ushort* sub, const int& n);
+
+public:
+	static SimdType detect();
+	static SimdType resolve(const SimdType& requested);
+	static const char* name(const SimdType& simd_type);
+
+	static int find_edges(const uchar* row, const int& x1, const int& x2, int* xs, const SimdType& simd_type);
+	static void radius_offsets(const int* cos_q, const int* sin_q, const int& cnt, const int& r, int* dx, int* dy, const SimdType& simd_type);
+	template <typename T> static bool any_ge(const T* p, const int& n, const int& tresh, const SimdType& simd_type);
+	template <typename T> static void add_sat(T* dst, const T* src, const int& n, const SimdType& simd_type);
+	static void hist_update(ushort* dst, const ushort* add, const ushort* sub, const int& n, const SimdType& simd_type);
+};
@@ -0,0 +1,133 @@
+#include "stats.h"
+
+/*!
+ * \brief Creates empty statistics.
+ */
+sample_stats::sample_stats() {
+	reset();
+}
+
+/*!
+ * \brief Records a sample. Lock-free and allocation-free, safe to call from concurrent threads.
+ * \param sample Sample value
+ */
+void sample_stats::record(const long long& sample) {
+	ring[next.fetch_add(1, memory_order_relaxed) % capacity].store(sample, memory_order_relaxed);
+
+	//the first recorder fixes the shift, all others use it
+	long long k = shift.load(memory_order_relaxed);
+	if (k == unset && shift.compare_exchange_strong(k, sample, memory_order_relaxed)) {
+		k = sample;
+	}
+
+	long long d = sample - k;
+	sum.fetch_add(d, memory_order_relaxed);
+	double sq = sum_sq.load(memory_order_relaxed);
+	while (!sum_sq.compare_exchange_weak(sq, sq + (double)d * d, memory_order_relaxed)) {
+	}
+
+	long long cur = min_val.load(memory_order_relaxed);
+	while (sample < cur && !min_val.compare_exchange_weak(cur, sample, memory_order_relaxed)) {
+	}
+	cur = max_val.load(memory_order_relaxed);
+	while (sample > cur && !max_val.compare_exchange_weak(cur, sample, memory_order_relaxed)) {
+	}
+
+	//counted last, so readers never see a sample without its sums
+	cnt.fetch_add(1, memory_order_release);
+}
+
+/*!
+ * \brief Drops all samples. Must not run concurrently with \link sample_stats::record \endlink.
+ */
+void sample_stats::reset() {
+	for (int i = 0; i < capacity; i++) {
+		ring[i].store(0, memory_order_relaxed);
+	}
+	next.store(0, memory_order_relaxed);
+	shift.store(unset, memory_order_relaxed);
+	sum.store(0, memory_order_relaxed);
+	sum_sq.store(0.0, memory_order_relaxed);
+	min_val.store(numeric_limits<long long>::max(), memory_order_relaxed);
+	max_val.store(numeric_limits<long long>::min(), memory_order_relaxed);
+	cnt.store(0, memory_order_release);
+}
+
+/*!
+ * \brief Returns the number of recorded samples.
+ * \return Number of samples
+ */
+long long sample_stats::count() const {
+	return cnt.load(memory_order_acquire);
+}
+
+/*!
+ * \brief Returns the mean of all samples.
+ * \return Mean (0 without samples)
+ */
+double sample_stats::mean() const {
+	long long n = count();
+	if (n == 0) {
+		return 0.0;
+	}
+	return shift.load(memory_order_relaxed) + (double)sum.load(memory_order_relaxed) / n;
+}
+
+/*!
+ * \brief Returns the (sample) variance of all samples.
+ * \return Variance (0 with less than two samples)
+ */
+double sample_stats::variance() const {
+	long long n = count();
+	if (n < 2) {
+		return 0.0;
+	}
+	double s = (double)sum.load(memory_order_relaxed);
+	return std::max(0.0, (sum_sq.load(memory_order_relaxed) - s * s / n) / (n - 1));
+}
+
+/*!
+ * \brief Returns the standard deviation of all samples.
+ * \return Standard deviation (0 with less than two samples)
+ */
+double sample_stats::stddev() const {
+	return sqrt(variance());
+}
+
+/*!
+ * \brief Returns the smallest sample.
+ * \return Minimum (0 without samples)
+ */
+long long sample_stats::min() const {
+	return (count() == 0) ? 0 : min_val.load(memory_order_relaxed);
+}
+
+/*!
+ * \brief Returns the largest sample.
+ * \return Maximum (0 without samples)
+ */
+long long sample_stats::max() const {
+	return (count() == 0) ? 0 : max_val.load(memory_order_relaxed);
+}
+
+/*!
+ * \brief Returns the p-th percentile (0..1) of the last \link sample_stats::capacity \endlink samples (nearest rank).
+		  Copies and sorts the ring buffer, meant for reporting rather than hot paths.
+ * \param p Percentile
+ * \return Percentile (0 without samples)
+ */
+long long sample_stats::percentile(const double& p) const {
+	long long n = std::min(count(), (long long)capacity);
+	if (n == 0) {
+		return 0;
+	}
+
+	vector<long long> sorted(n);
+	for (long long i = 0; i < n; i++) {
+		sorted[i] = ring[i].load(memory_order_relaxed);
+	}
+	sort(sorted.begin(), sorted.end());
+
+	long long rank = (long long)ceil(p * n);
+	return sorted[std::min(n, std::max(1LL, rank)) - 1];
+}
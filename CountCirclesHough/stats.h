@@ -0,0 +1,44 @@
+#pragma once
+
+#include "globals.h"
+
+/*!
+ * \brief Lock-free statistics of a series of samples (e.g. runtimes in nanoseconds).
+		  Count, mean, variance, minimum and maximum are kept online over all samples,
+		  percentiles over the last samples in a fixed-size ring buffer. Recording never allocates
+		  and may run on any number of threads at once; reads are exact once recording threads are quiet.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class sample_stats
+{
+public:
+	static const int capacity = 1024; //!< Number of most recent samples kept for percentiles.
+
+private:
+	static const long long unset = numeric_limits<long long>::min();
+
+	atomic<long long> ring[capacity];
+	atomic<long long> next; //!< Ring buffer slot of the next sample (ever-increasing)
+	atomic<long long> cnt;
+	atomic<long long> shift; //!< First sample; sums are taken around it, so the variance does not cancel out
+	atomic<long long> sum;
+	atomic<double> sum_sq;
+	atomic<long long> min_val;
+	atomic<long long> max_val;
+
+public:
+	sample_stats();
+	sample_stats(const sample_stats&) = delete;
+	sample_stats& operator=(const sample_stats&) = delete;
+
+	void record(const long long& sample);
+	void reset();
+	long long count() const;
+	double mean() const;
+	double variance() const;
+	double stddev() const;
+	long long min() const;
+	long long max() const;
+	long long percentile(const double& p) const;
+};
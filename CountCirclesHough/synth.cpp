@@ -0,0 +1,203 @@
+#include "synth.h"
+#include <random>
+
+/*!
+ * \brief Checks whether a new circle keeps a gap of at least 2 pixels to all placed circles.
+ * \param truth Placed circles; tuple: x,y,r
+ * \param x Center x
+ * \param y Center y
+ * \param r Radius
+ */
+bool synth::fits(const vector<tuple<int, int, int>>& truth, const int& x, const int& y, const int& r) {
+	for (size_t i = 0; i < truth.size(); i++) {
+		int dx = get<0>(truth[i]) - x;
+		int dy = get<1>(truth[i]) - y;
+		int gap = get<2>(truth[i]) + r + 2;
+		if (dx * dx + dy * dy < gap * gap) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*!
+ * \brief Renders a color test image of filled, non-overlapping circles (dark or bright)
+		  on a gray background, fully inside the image. Circles that can't be placed are skipped.
+		  Clutter rectangles are drawn first, circles on top; occluding bars are drawn in background color.
+ * \param width Image width
+ * \param height Image height
+ * \param circle_cnt Number of circles to place
+ * \param min_radius Minimum circle radius
+ * \param max_radius Maximum circle radius
+ * \param noise_sd Standard deviation of additive gaussian noise (0 = none)
+ * \param occlusion Percentage of circles with a third of their area covered (0..100)
+ * \param clutter Number of random non-circular distractors (filled rectangles)
+ * \param seed Random generator seed (same seed, same image)
+ * \param truth Output list of placed circles; tuple: x,y,r
+ */
+Mat synth::render(
+	const int& width,
+	const int& height,
+	const int& circle_cnt,
+	const int& min_radius,
+	const int& max_radius,
+	const double& noise_sd,
+	const int& occlusion,
+	const int& clutter,
+	const int& seed,
+	vector<tuple<int, int, int>>& truth)
+{
+	const int background = 110;
+	Mat img(height, width, CV_8UC1, Scalar(background));
+	mt19937 rng(seed);
+	uniform_int_distribution<int> dist_shade(0, 1);
+	uniform_int_distribution<int> dist_percent(0, 99);
+	uniform_int_distribution<int> dist_r(min_radius, max(min_radius, max_radius));
+
+	truth.clear();
+
+	//clutter: rectangles of random size and shade
+
+	for (int i = 0; i < clutter; i++) {
+		uniform_int_distribution<int> dist_size(3, max(3, 2 * max_radius));
+		int w = min(dist_size(rng), width);
+		int h = min(dist_size(rng), height);
+		uniform_int_distribution<int> dist_x(0, width - w);
+		uniform_int_distribution<int> dist_y(0, height - h);
+		img(Rect(dist_x(rng), dist_y(rng), w, h)).setTo(Scalar(dist_shade(rng) ? 180 : 50));
+	}
+
+	//circles: up to 100 placement attempts per circle
+
+	for (int i = 0; i < circle_cnt; i++) {
+		int r = dist_r(rng);
+		if (2 * r + 1 > width || 2 * r + 1 > height) {
+			continue;
+		}
+		uniform_int_distribution<int> dist_x(r, width - 1 - r);
+		uniform_int_distribution<int> dist_y(r, height - 1 - r);
+
+		for (int attempt = 0; attempt < 100; attempt++) {
+			int x = dist_x(rng);
+			int y = dist_y(rng);
+			if (fits(truth, x, y, r)) {
+				cv::circle(img, Point(x, y), r, Scalar(dist_shade(rng) ? 210 : 20), FILLED);
+				truth.push_back(make_tuple(x, y, r));
+				break;
+			}
+		}
+	}
+
+	//occlusion: cover the outer third of a circle on a random side
+
+	for (size_t i = 0; i < truth.size(); i++) {
+		if (dist_percent(rng) >= occlusion) {
+			continue;
+		}
+		int x = get<0>(truth[i]), y = get<1>(truth[i]), r = get<2>(truth[i]);
+		int cut = max(1, (2 * r + 1) / 3);
+		Rect bar;
+		switch (uniform_int_distribution<int>(0, 3)(rng)) {
+		case 0: bar = Rect(x - r, y - r, 2 * r + 1, cut); break; //top
+		case 1: bar = Rect(x - r, y + r + 1 - cut, 2 * r + 1, cut); break; //bottom
+		case 2: bar = Rect(x - r, y - r, cut, 2 * r + 1); break; //left
+		default: bar = Rect(x + r + 1 - cut, y - r, cut, 2 * r + 1); break; //right
+		}
+		img(bar).setTo(Scalar(background));
+	}
+
+	//additive gaussian noise
+
+	if (noise_sd > 0) {
+		normal_distribution<double> dist_noise(0.0, noise_sd);
+		for (int j = 0; j < height; j++) {
+			uchar* row = img.ptr<uchar>(j);
+			for (int i = 0; i < width; i++) {
+				row[i] = (uchar)min(255.0, max(0.0, row[i] + dist_noise(rng) + 0.5));
+			}
+		}
+	}
+
+	Mat color;
+	cv::cvtColor(img, color, COLOR_GRAY2BGR);
+	return color;
+}
+
+/*!
+ * \brief Writes ground truth circles as CSV (header x,y,r).
+ * \param path Output file path
+ * \param truth List of circles; tuple: x,y,r
+ */
+bool synth::write_truth(const string& path, const vector<tuple<int, int, int>>& truth) {
+	ofstream out(path);
+	if (!out.good()) {
+		return false;
+	}
+	out << "x,y,r\n";
+	for (size_t i = 0; i < truth.size(); i++) {
+		out << get<0>(truth[i]) << "," << get<1>(truth[i]) << "," << get<2>(truth[i]) << "\n";
+	}
+	return out.good();
+}
+
+/*!
+ * \brief Reads ground truth circles written by \link synth::write_truth \endlink.
+		  Lines that don't parse (e.g. the header) are skipped.
+ * \param path Input file path
+ */
+vector<tuple<int, int, int>> synth::read_truth(const string& path) {
+	vector<tuple<int, int, int>> truth;
+	ifstream in(path);
+	string line;
+	while (getline(in, line)) {
+		int x, y, r;
+		if (sscanf(line.c_str(), "%d,%d,%d", &x, &y, &r) == 3) {
+			truth.push_back(make_tuple(x, y, r));
+		}
+	}
+	return truth;
+}
+
+/*!
+ * \brief Matches found circles to ground truth, one to one. Every ground truth circle takes the
+		  closest unmatched found circle within the center and radius tolerance.
+ * \param found List of found circles; tuple: x,y,r
+ * \param truth List of ground truth circles; tuple: x,y,r
+ * \param center_tol Maximum euclidean distance between centers
+ * \param radius_tol Maximum absolute radius difference
+ */
+synth_score synth::score(
+	const vector<tuple<int, int, int>>& found,
+	const vector<tuple<int, int, int>>& truth,
+	const int& center_tol,
+	const int& radius_tol)
+{
+	vector<bool> matched(found.size(), false);
+	synth_score result = synth_score();
+
+	for (size_t i = 0; i < truth.size(); i++) {
+		int best = -1;
+		long long best_dist = (long long)center_tol * center_tol;
+		for (size_t j = 0; j < found.size(); j++) {
+			if (matched[j] || abs(get<2>(found[j]) - get<2>(truth[i])) > radius_tol) {
+				continue;
+			}
+			long long dx = get<0>(found[j]) - get<0>(truth[i]);
+			long long dy = get<1>(found[j]) - get<1>(truth[i]);
+			if (dx * dx + dy * dy <= best_dist) {
+				best_dist = dx * dx + dy * dy;
+				best = (int)j;
+			}
+		}
+		if (best >= 0) {
+			matched[best] = true;
+			result.true_pos++;
+		}
+	}
+
+	result.false_pos = (int)found.size() - result.true_pos;
+	result.false_neg = (int)truth.size() - result.true_pos;
+	result.precision = found.empty() ? 0.0 : (double)result.true_pos / found.size();
+	result.recall = truth.empty() ? 0.0 : (double)result.true_pos / truth.size();
+	return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "globals.h"
+
+/*! \brief Accuracy of found circles against ground truth. */
+struct synth_score {
+	int true_pos; //!< Found circles matching a ground truth circle
+	int false_pos; //!< Found circles matching no ground truth circle
+	int false_neg; //!< Ground truth circles not found
+	double precision; //!< true_pos / found
+	double recall; //!< true_pos / ground truth
+};
+
+/*!
+ * \brief Synthetic test images with known circles, and scoring of found circles against them.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class synth
+{
+private:
+	static bool fits(const vector<tuple<int, int, int>>& truth, const int& x, const int& y, const int& r);
+
+public:
+	static Mat render(
+		const int& width,
+		const int& height,
+		const int& circle_cnt,
+		const int& min_radius,
+		const int& max_radius,
+		const double& noise_sd,
+		const int& occlusion,
+		const int& clutter,
+		const int& seed,
+		vector<tuple<int, int, int>>& truth);
+	static bool write_truth(const string& path, const vector<tuple<int, int, int>>& truth);
+	static vector<tuple<int, int, int>> read_truth(const string& path);
+	static synth_score score(
+		const vector<tuple<int, int, int>>& found,
+		const vector<tuple<int, int, int>>& truth,
+		const int& center_tol,
+		const int& radius_tol);
+};
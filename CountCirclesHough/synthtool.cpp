@@ -0,0 +1,260 @@
+/*!
+ *
+ * \brief Synthetic test image generator and accuracy scorer.
+ *
+ * Generate an image with known circles (writes the image and its ground truth as CSV x,y,r):<br>
+ * \code{.sh}
+ * make synth
+ * ./CountCirclesHoughSynth -mode=0 -width=2048 -height=2048 -circles=64 -min-radius=15 -max-radius=30 -noise=8 -occlusion=20 -clutter=32 -seed=7 -image=synth.png -truth=synth.csv
+ * \endcode
+ * Evaluate a hough configuration for throughput and precision/recall, on a generated image
+ * (same generator parameters as above) or on a given image with its ground truth:<br>
+ * \code{.sh}
+ * ./CountCirclesHoughSynth -mode=1 -width=2048 -height=2048 -circles=64 -imp=1 -omp-threads=4 -stencil=1 -reps=5 -out=eval.jsonl
+ * ./CountCirclesHoughSynth -mode=1 synth.png -truth=synth.csv -imp=1 -omp-threads=4 -reps=5
+ * mpiexec -n 5 ./CountCirclesHoughSynth -mode=1 synth.png -truth=synth.csv -imp=2 -mpi=2 -reps=5
+ * \endcode
+ * With <i>-imp=2</i>, every MPI process prepares the same edge image and takes part in the transformation;
+ * the root process scores and reports.
+ * A found circle matches a ground truth circle if the centers are at most <i>-center-tol</i> pixels apart
+ * and the radii differ by at most <i>-radius-tol</i>.
+ *
+ * \copyright MIT License
+ * \author 97131004
+ */
+
+#include "globals.h"
+#include "blur.h"
+#include "edges.h"
+#include "engine.h"
+#include "metrics.h"
+#include "synth.h"
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+/*! \brief Command line parameters. */
+const cv::String keys =
+	"{@img||}"
+	"{mode|1|}"
+	"{width|1024|}"
+	"{height|1024|}"
+	"{circles|32|}"
+	"{noise|8|}"
+	"{occlusion|0|}"
+	"{clutter|0|}"
+	"{seed|1|}"
+	"{image||}"
+	"{truth||}"
+	"{imp|1|}"
+	"{mpi|0|}"
+	"{omp-threads|2|}"
+	"{blur|0|}"
+	"{blur-ksize|5|}"
+	"{edges|1|}"
+	"{edges-ksize|3|}"
+	"{sobel-bw-tresh|128|}"
+	"{canny-tresh1|100|}"
+	"{canny-tresh2|200|}"
+	"{min-radius|15|}"
+	"{max-radius|30|}"
+	"{peak-tresh|125|}"
+	"{use-binning|1|}"
+	"{bin-size|32|}"
+	"{use-spacing|1|}"
+	"{spacing-size|40|}"
+	"{tile-size|0|}"
+	"{acc-layout|0|}"
+	"{simd|3|}"
+	"{stencil|0|}"
+	"{normalize|0|}"
+	"{reps|3|}"
+	"{center-tol|4|}"
+	"{radius-tol|2|}"
+	"{out||}"
+	"{format|1|}";
+
+/*!
+ * \brief Generator and scorer entry point.
+ * \param argc Number of strings pointed to by argv
+ * \param argv Array of arguments
+ */
+int main(int argc, char* argv[])
+{
+	cv::CommandLineParser cmd(argc, argv, keys);
+
+	int mode = cmd.get<int>("mode");
+	int min_radius = cmd.get<int>("min-radius");
+	int max_radius = cmd.get<int>("max-radius");
+	string img_path = cmd.get<string>("@img");
+	string image_out = cmd.get<string>("image");
+	string truth_path = cmd.get<string>("truth");
+
+	Mat src;
+	vector<tuple<int, int, int>> truth;
+
+	//input: generated image, or given image with its ground truth
+
+	if (mode == 0 || img_path.empty()) {
+		src = synth::render(cmd.get<int>("width"), cmd.get<int>("height"), cmd.get<int>("circles"), min_radius, max_radius,
+			cmd.get<double>("noise"), cmd.get<int>("occlusion"), cmd.get<int>("clutter"), cmd.get<int>("seed"), truth);
+	}
+	else {
+		src = imread(img_path, IMREAD_COLOR);
+		truth = synth::read_truth(truth_path);
+		if (!src.data || truth_path.empty()) {
+			cout << "Input data invalid (image and -truth required)." << endl;
+			return -1;
+		}
+	}
+
+	if (mode == 0) {
+		if (image_out.empty() || truth_path.empty()) {
+			cout << "Output paths missing (-image and -truth required)." << endl;
+			return -1;
+		}
+		if (!imwrite(image_out, src) || !synth::write_truth(truth_path, truth)) {
+			cout << "Writing output failed." << endl;
+			return -1;
+		}
+		cout << "generated " << src.cols << "x" << src.rows << " image with " << truth.size() << " circles" << endl;
+		return 0;
+	}
+
+	ImpType imp_type = static_cast<ImpType>(cmd.get<int>("imp"));
+	MpiType mpi_type = static_cast<MpiType>(cmd.get<int>("mpi"));
+	int world_size = 1;
+	int world_rank = 0;
+
+	if (imp_type == ImpType::openmpi) {
+		MPI_Init(&argc, &argv);
+		MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+		MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+		if (world_size < 2) {
+			cout << "MPI runs need at least 2 processes (root and one worker)." << endl;
+			MPI_Finalize();
+			return -1;
+		}
+	}
+
+	int omp_threads = cmd.get<int>("omp-threads");
+	int reps = max(1, cmd.get<int>("reps"));
+	MetricsFormat out_format = static_cast<MetricsFormat>(cmd.get<int>("format"));
+
+	//preprocessing (not timed): grayscale, blur, edge detection
+
+	Mat gray, blurred, edge_img;
+	cv::cvtColor(src, gray, COLOR_BGR2GRAY);
+
+	EdgesType edges_type = static_cast<EdgesType>(cmd.get<int>("edges"));
+
+	if (edges_type == EdgesType::gaussian_sobel) {
+		edge_img = edges::gaussian_sobel(gray, cmd.get<int>("blur-ksize"), cmd.get<int>("sobel-bw-tresh"), cmd.get<int>("edges-ksize"), omp_threads);
+	}
+	else {
+		if (static_cast<BlurType>(cmd.get<int>("blur")) == BlurType::median) {
+			blurred = blur::median(gray, cmd.get<int>("blur-ksize"));
+		}
+		else if (static_cast<BlurType>(cmd.get<int>("blur")) == BlurType::median_const) {
+			blurred = blur::median_const(gray, cmd.get<int>("blur-ksize"), omp_threads, static_cast<SimdType>(cmd.get<int>("simd")));
+		}
+		else {
+			blurred = blur::gaussian(gray, cmd.get<int>("blur-ksize"));
+		}
+
+		if (edges_type == EdgesType::canny) {
+			edge_img = edges::canny(blurred, cmd.get<int>("canny-tresh1"), cmd.get<int>("canny-tresh2"), cmd.get<int>("edges-ksize"));
+		}
+		else {
+			edge_img = edges::sobel(blurred, cmd.get<int>("sobel-bw-tresh"), cmd.get<int>("edges-ksize"));
+		}
+	}
+
+	//hough runs, one detector keeps its buffers and stencils across all repetitions
+
+	hough_params params;
+	params.imp_type = imp_type;
+	params.mpi_type = mpi_type;
+	params.min_radius = min_radius;
+	params.max_radius = max_radius;
+	params.peak_tresh = cmd.get<int>("peak-tresh");
+	params.use_binning = cmd.get<int>("use-binning");
+	params.bin_size = cmd.get<int>("bin-size");
+	params.use_spacing = cmd.get<int>("use-spacing");
+	params.spacing_size = cmd.get<int>("spacing-size");
+	params.omp_threads = omp_threads;
+	params.tile_size = cmd.get<int>("tile-size");
+	params.acc_layout = static_cast<AccLayout>(cmd.get<int>("acc-layout"));
+	params.simd_type = static_cast<SimdType>(cmd.get<int>("simd"));
+	params.stencil_type = static_cast<StencilType>(cmd.get<int>("stencil"));
+	params.use_normalize = cmd.get<int>("normalize");
+	hough_engine engine(params);
+
+	vector<long long> samples;
+	vector<hough_circle> circles;
+	vector<tuple<int, int, int>> found;
+
+	for (int i = 0; i < reps; i++) {
+		if (imp_type == ImpType::openmpi) {
+			MPI_Barrier(MPI_COMM_WORLD);
+		}
+		long long start = metrics::now();
+		const hough_result& res = engine.detect(edge_img);
+		samples.push_back(metrics::now() - start);
+		circles = res.circles;
+	}
+
+	sort(samples.begin(), samples.end());
+
+	//only the root process holds the found circles (mpi)
+	if (world_rank != 0) {
+		MPI_Finalize();
+		return 0;
+	}
+
+	for (size_t i = 0; i < circles.size(); i++) {
+		found.push_back(make_tuple(circles[i].x, circles[i].y, circles[i].r));
+	}
+
+	synth_score result = synth::score(found, truth, cmd.get<int>("center-tol"), cmd.get<int>("radius-tol"));
+	double f1 = (result.precision + result.recall) > 0 ? 2 * result.precision * result.recall / (result.precision + result.recall) : 0.0;
+
+	//report: one JSON object per line or one CSV row
+
+	stringstream line;
+	string out_path = cmd.get<string>("out");
+	bool header = out_format == MetricsFormat::metrics_csv && (out_path.empty() || ifstream(out_path).peek() == ifstream::traits_type::eof());
+
+	if (out_format == MetricsFormat::metrics_csv) {
+		if (header) {
+			line << "width,height,truth,found,true_pos,false_pos,false_neg,precision,recall,f1,imp,mpi,procs,omp_threads,reps,median_ns\n";
+		}
+		line << src.cols << "," << src.rows << "," << truth.size() << "," << found.size() << ","
+			<< result.true_pos << "," << result.false_pos << "," << result.false_neg << ","
+			<< result.precision << "," << result.recall << "," << f1 << ","
+			<< imp_type << "," << mpi_type << "," << world_size << "," << omp_threads << "," << reps << "," << samples[samples.size() / 2] << "\n";
+	}
+	else {
+		line << "{\"width\":" << src.cols << ",\"height\":" << src.rows << ",\"truth\":" << truth.size()
+			<< ",\"found\":" << found.size() << ",\"true_pos\":" << result.true_pos
+			<< ",\"false_pos\":" << result.false_pos << ",\"false_neg\":" << result.false_neg
+			<< ",\"precision\":" << result.precision << ",\"recall\":" << result.recall << ",\"f1\":" << f1
+			<< ",\"imp\":" << imp_type << ",\"mpi\":" << mpi_type << ",\"procs\":" << world_size << ",\"omp_threads\":" << omp_threads << ",\"reps\":" << reps
+			<< ",\"median_ns\":" << samples[samples.size() / 2] << "}\n";
+	}
+
+	if (out_path.empty()) {
+		cout << line.str();
+	}
+	else {
+		ofstream out(out_path, ios_base::app);
+		out << line.str();
+	}
+
+	if (imp_type == ImpType::openmpi) {
+		MPI_Finalize();
+	}
+
+	return 0;
+}
@@ -0,0 +1,456 @@
+/*!
+ *
+ * \brief Regression tests of the detection library.
+ *
+ * Every test prints one line (ok / FAIL) and the program exits non-zero if any test failed.
+ *
+ * Build and run:<br>
+ * \code{.sh}
+ * make test
+ * make test-mpi
+ * \endcode
+ * The MPI tests run with "mpi" as the only argument, under mpiexec with at least 2 processes.
+ *
+ * \copyright MIT License
+ * \author 97131004
+ */
+
+#include "globals.h"
+#include "engine.h"
+#include "blur.h"
+#include "edges.h"
+#include "metrics.h"
+
+int failed = 0; //!< Number of failed tests.
+int world_rank = 0; //!< Process ID of an MPI process (MPI tests only report on the root).
+
+/*!
+ * \brief Reports the outcome of a test.
+ * \param name Test name
+ * \param ok Test passed
+ */
+void check(const string& name, const bool& ok) {
+	if (world_rank != 0) {
+		return;
+	}
+	cout << (ok ? "ok   " : "FAIL ") << name << endl;
+	if (!ok) {
+		failed++;
+	}
+}
+
+/*!
+ * \brief Creates an edge image with clean, one pixel wide circles.
+ * \param width Image width
+ * \param height Image height
+ * \param circles Circles; tuple: x,y,r
+ * \return Edge image (255 = edge)
+ */
+Mat circle_edges(const int& width, const int& height, const vector<tuple<int, int, int>>& circles) {
+	Mat img = Mat::zeros(height, width, CV_8UC1);
+	for (size_t i = 0; i < circles.size(); i++) {
+		for (int t = 0; t < 1440; t++) {
+			int x = (int)lround(get<0>(circles[i]) + get<2>(circles[i]) * cos(t * CV_PI / 720));
+			int y = (int)lround(get<1>(circles[i]) + get<2>(circles[i]) * sin(t * CV_PI / 720));
+			if (x >= 0 && x < width && y >= 0 && y < height) {
+				img.ptr<uchar>(y)[x] = 255;
+			}
+		}
+	}
+	return img;
+}
+
+/*!
+ * \brief A small clean circle has fewer than 256 edge pixels, but the angle stencil votes its center
+		  more than 255 times; the peak score must not be clipped by a too narrow counter.
+ */
+void test_small_circle_not_clipped() {
+	Mat img = circle_edges(64, 64, { make_tuple(32, 32, 15) });
+
+	hough_params params;
+	params.min_radius = 15;
+	params.max_radius = 15;
+	params.peak_tresh = 100;
+	params.bin_size = 64;
+	params.stencil_type = StencilType::stencil_angles;
+
+	hough_engine engine(params);
+	const hough_result& result = engine.detect(img);
+
+	check("small circle found", result.circles.size() == 1 && result.circles[0].x == 32 && result.circles[0].y == 32 && result.circles[0].r == 15);
+	check("small circle peak not clipped", !result.circles.empty() && result.circles[0].score > 255 && result.acc_elem_size > 1);
+}
+
+/*!
+ * \brief Forcing wider accumulator counters (16 and 32 bit) finds the same circles as the automatic width,
+		  with and without binning (both peak scans skip rows and bins through the vectorized treshold check).
+ */
+void test_forced_counter_widths() {
+	Mat img = circle_edges(96, 64, { make_tuple(30, 32, 14), make_tuple(68, 30, 12) });
+	const AccType widths[3] = { AccType::acc_u8, AccType::acc_u16, AccType::acc_u32 };
+
+	for (int b = 0; b < 2; b++) {
+		hough_params params;
+		params.min_radius = 10;
+		params.max_radius = 16;
+		params.peak_tresh = 200;
+		params.use_binning = (b == 1);
+		params.bin_size = 32;
+		params.spacing_size = 20;
+
+		vector<tuple<int, int, int>> expected;
+		for (int w = 0; w < 3; w++) {
+			params.min_acc_type = widths[w];
+			hough_engine engine(params);
+			const hough_result& result = engine.detect(img);
+
+			vector<tuple<int, int, int>> found;
+			for (size_t i = 0; i < result.circles.size(); i++) {
+				found.push_back(make_tuple(result.circles[i].x, result.circles[i].y, result.circles[i].r));
+			}
+			if (w == 0) {
+				expected = found;
+			}
+
+			string name = "forced " + to_string(8 << w) + "-bit counters" + (params.use_binning ? " (binning)" : "");
+			check(name + " use their width", result.acc_elem_size >= (1 << w));
+			check(name + " find the same circles", expected.size() == 2 && found == expected);
+		}
+	}
+}
+
+/*!
+ * \brief Sequential and OpenMP voting (1, 2 and 4 threads), untiled and tiled, both accumulator layouts and
+		  every SIMD type the CPU supports produce the same accumulator (acc_hash) and the same circles, per stencil.
+		  Circles lie inside and across the image border, so both voting paths (with and without bounds checks) run.
+ */
+void test_backends_identical() {
+	Mat img = circle_edges(120, 100, { make_tuple(30, 40, 14), make_tuple(88, 30, 12), make_tuple(62, 88, 16), make_tuple(4, 80, 11) });
+	const StencilType stencils[2] = { StencilType::stencil_angles, StencilType::stencil_midpoint };
+	const AccLayout layouts[2] = { AccLayout::planar, AccLayout::radius_inner };
+	const int tiles[2] = { 0, 24 };
+	vector<SimdType> simd_types;
+	for (int t = SimdType::simd_scalar; t <= SimdType::simd_auto; t++) {
+		if (t == SimdType::simd_auto || simd::resolve(static_cast<SimdType>(t)) == t) {
+			simd_types.push_back(static_cast<SimdType>(t));
+		}
+	}
+
+	hough::enable_acc_hash(true);
+	for (int s = 0; s < 2; s++) {
+		hough_params params;
+		params.min_radius = 10;
+		params.max_radius = 16;
+		params.peak_tresh = (s == 0) ? 200 : 40;
+		params.bin_size = 24;
+		params.spacing_size = 15;
+		params.stencil_type = stencils[s];
+
+		long long hash_ref = 0;
+		vector<tuple<int, int, int>> circles_ref;
+		int runs = 0, hash_same = 0, circles_same = 0;
+
+		//sequential (1 thread) and openmp with 1, 2 and 4 threads
+		for (int threads = 0; threads <= 4; threads = (threads == 0) ? 1 : threads * 2) {
+			for (int t = 0; t < 2; t++) {
+				for (int l = 0; l < 2; l++) {
+					for (size_t v = 0; v < simd_types.size(); v++) {
+						params.imp_type = (threads == 0) ? ImpType::sequential : ImpType::openmp;
+						params.omp_threads = max(1, threads);
+						params.tile_size = tiles[t];
+						params.acc_layout = layouts[l];
+						params.simd_type = simd_types[v];
+
+						hough_engine engine(params);
+						const hough_result& result = engine.detect(img);
+						long long hash = metrics::counter(engine.metrics(), "acc_hash");
+						vector<tuple<int, int, int>> found;
+						for (size_t i = 0; i < result.circles.size(); i++) {
+							found.push_back(make_tuple(result.circles[i].x, result.circles[i].y, result.circles[i].r));
+						}
+
+						if (runs == 0) {
+							hash_ref = hash;
+							circles_ref = found;
+						}
+						runs++;
+						hash_same += (hash == hash_ref);
+						circles_same += (found == circles_ref);
+					}
+				}
+			}
+		}
+
+		string name = string("backends (") + ((s == 0) ? "angles" : "midpoint") + " stencil, " + to_string(runs) + " runs)";
+		check(name + " give identical accumulators", hash_ref != 0 && hash_same == runs);
+		check(name + " find identical circles", circles_ref.size() >= 3 && circles_same == runs);
+	}
+	hough::enable_acc_hash(false);
+}
+
+/*!
+ * \brief The constant-time median filter equals a plain median over replicated borders, for kernels
+		  smaller and larger than the image, with one and several strips of rows.
+ */
+void test_median_const() {
+	Mat img(70, 41, CV_8UC1);
+	unsigned int state = 12345;
+	for (int y = 0; y < img.rows; y++) {
+		for (int x = 0; x < img.cols; x++) {
+			state = state * 1103515245 + 12345;
+			img.ptr<uchar>(y)[x] = (uchar)((state >> 16) & 0xFF);
+		}
+	}
+
+	const int ksizes[3] = { 3, 9, 45 };
+	for (int k = 0; k < 3; k++) {
+		for (int threads = 1; threads <= 2; threads++) {
+			int r = ksizes[k] / 2;
+			Mat result = blur::median_const(img, ksizes[k], threads, SimdType::simd_scalar);
+
+			bool same = true;
+			vector<uchar> window;
+			for (int y = 0; y < img.rows; y++) {
+				for (int x = 0; x < img.cols; x++) {
+					window.clear();
+					for (int j = -r; j <= r; j++) {
+						for (int i = -r; i <= r; i++) {
+							window.push_back(img.ptr<uchar>(min(img.rows - 1, max(0, y + j)))[min(img.cols - 1, max(0, x + i))]);
+						}
+					}
+					nth_element(window.begin(), window.begin() + window.size() / 2, window.end());
+					same = same && result.ptr<uchar>(y)[x] == window[window.size() / 2];
+				}
+			}
+			check("median_const ksize " + to_string(ksizes[k]) + ", " + to_string(threads) + " thread(s)", same);
+		}
+	}
+}
+
+/*!
+ * \brief The gradient direction of the fused blur and sobel kernel points from the border of a bright disc towards its center
+		  (0 off edges), and computing it leaves the edge image unchanged.
+ */
+void test_gaussian_sobel_direction() {
+	Mat img = Mat::zeros(64, 80, CV_8UC1);
+	for (int y = 0; y < img.rows; y++) {
+		for (int x = 0; x < img.cols; x++) {
+			img.ptr<uchar>(y)[x] = ((x - 40) * (x - 40) + (y - 30) * (y - 30) <= 15 * 15) ? 200 : 0;
+		}
+	}
+
+	Mat dir;
+	Mat edge_img = edges::gaussian_sobel(img, 5, 60, 3, 2, &dir);
+	Mat edge_only = edges::gaussian_sobel(img, 5, 60, 3, 2);
+
+	int edge_cnt = 0, inward = 0;
+	bool same = true, zero = true;
+	for (int y = 0; y < img.rows; y++) {
+		for (int x = 0; x < img.cols; x++) {
+			same = same && edge_img.ptr<uchar>(y)[x] == edge_only.ptr<uchar>(y)[x];
+			if (edge_img.ptr<uchar>(y)[x] == 0) {
+				zero = zero && dir.ptr<short>(y)[x] == 0;
+				continue;
+			}
+			//angle between the direction and the direction to the center, in degrees (0-180)
+			double center = atan2(30.0 - y, 40.0 - x) * 180 / CV_PI;
+			double off = fabs(fmod(dir.ptr<short>(y)[x] - center + 540, 360.0) - 180);
+			edge_cnt++;
+			inward += (off <= 20);
+		}
+	}
+
+	check("gaussian_sobel edge image unchanged by the direction output", same && edge_cnt > 0);
+	check("gaussian_sobel directions point to the brighter side", inward == edge_cnt);
+	check("gaussian_sobel directions are 0 off edges", zero);
+}
+
+/*!
+ * \brief Buffers kept from a larger detection stay accounted in later runs, and are freed rather than pushing
+		  a smaller detection over its memory budget.
+ */
+void test_kept_buffers_budget() {
+	Mat big = circle_edges(160, 120, { make_tuple(60, 60, 14) });
+	Mat small = circle_edges(40, 40, { make_tuple(20, 20, 12) });
+
+	hough_params params;
+	params.min_radius = 9;
+	params.max_radius = 15;
+	params.peak_tresh = 200;
+	params.bin_size = 20;
+	params.spacing_size = 10;
+
+	hough_engine engine(params);
+	engine.detect(big);
+	engine.begin_run();
+	long long need = engine.detect(small).mem_need;
+	check("kept buffers stay accounted", metrics::counter(engine.metrics(), "mem_peak_bytes") > need);
+
+	params.mem_budget = need;
+	engine.set_params(params);
+	engine.begin_run();
+	const hough_result& result = engine.detect(small);
+	check("kept buffers do not refuse a detection within the budget", !result.refused && result.circles.size() == 1);
+	engine.begin_run();
+	engine.detect(small);
+	check("kept buffers are freed for the budget", metrics::counter(engine.metrics(), "mem_peak_bytes") == need);
+}
+
+/*!
+ * \brief Two detectors running on two threads at the same time find the same circles as alone,
+		  and every run records the same metrics (counters and buffer bytes) as their runs alone.
+ */
+void test_concurrent_engines() {
+	const int runs = 500; //short runs, so recording of both detectors overlaps often
+	Mat img[2] = {
+		circle_edges(40, 40, { make_tuple(20, 20, 12) }),
+		circle_edges(48, 40, { make_tuple(24, 20, 10) })
+	};
+
+	hough_params params;
+	params.min_radius = 9;
+	params.max_radius = 13;
+	params.peak_tresh = 200;
+	params.bin_size = 20;
+	params.spacing_size = 10;
+
+	hough_engine engines[2] = { hough_engine(params), hough_engine(params) };
+	vector<tuple<int, int, int>> expected[2];
+	vector<tuple<string, long long>> expected_counters[2];
+
+	//reference: each detector alone
+	for (int e = 0; e < 2; e++) {
+		engines[e].begin_run();
+		const hough_result& result = engines[e].detect(img[e]);
+		for (size_t i = 0; i < result.circles.size(); i++) {
+			expected[e].push_back(make_tuple(result.circles[i].x, result.circles[i].y, result.circles[i].r));
+		}
+		expected_counters[e] = engines[e].metrics().counters;
+	}
+
+	bool same[2] = { true, true };
+	bool same_metrics[2] = { true, true };
+	vector<thread> threads;
+	for (int e = 0; e < 2; e++) {
+		threads.push_back(thread([&, e]() {
+			for (int k = 0; k < runs; k++) {
+				engines[e].begin_run();
+				const hough_result& result = engines[e].detect(img[e]);
+				vector<tuple<int, int, int>> found;
+				for (size_t i = 0; i < result.circles.size(); i++) {
+					found.push_back(make_tuple(result.circles[i].x, result.circles[i].y, result.circles[i].r));
+				}
+				same[e] = same[e] && found == expected[e];
+				same_metrics[e] = same_metrics[e] && engines[e].metrics().counters == expected_counters[e];
+			}
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	check("concurrent engines find the same circles", same[0] && same[1] && expected[0].size() == 1 && expected[1].size() == 1);
+	check("concurrent engines record the metrics of their runs alone", same_metrics[0] && same_metrics[1] &&
+		metrics::counter(engines[0].metrics(), "vote_count") != metrics::counter(engines[1].metrics(), "vote_count") &&
+		metrics::counter(engines[0].metrics(), "mem_peak_bytes") > 0 && metrics::counter(engines[1].metrics(), "mem_peak_bytes") > 0);
+}
+
+/*!
+ * \brief Every MPI field size (full, crop, rows), with single-threaded and hybrid workers and both accumulator layouts,
+		  produces the accumulator (acc_hash) and the circles of the sequential implementation, per stencil.
+		  The largest process holds exactly the bytes its memory estimate (mem_need) predicts.
+ * \param world_size Number of all MPI processes
+ */
+void test_mpi_identical(const int& world_size) {
+	Mat img = circle_edges(120, 100, { make_tuple(30, 40, 14), make_tuple(88, 30, 12), make_tuple(62, 88, 16), make_tuple(4, 80, 11) });
+	const StencilType stencils[2] = { StencilType::stencil_angles, StencilType::stencil_midpoint };
+	const MpiType mpi_types[3] = { MpiType::full, MpiType::crop, MpiType::rows };
+	const string mpi_names[3] = { "full", "crop", "rows" };
+	const AccLayout layouts[2] = { AccLayout::planar, AccLayout::radius_inner };
+
+	hough::enable_acc_hash(true);
+	for (int s = 0; s < 2; s++) {
+		hough_params params;
+		params.min_radius = 10;
+		params.max_radius = 16;
+		params.peak_tresh = (s == 0) ? 200 : 40;
+		params.bin_size = 24;
+		params.spacing_size = 15;
+		params.stencil_type = stencils[s];
+
+		//reference: sequential, on every process
+		hough_engine seq(params);
+		const hough_result& seq_result = seq.detect(img);
+		long long hash_ref = metrics::counter(seq.metrics(), "acc_hash");
+		vector<tuple<int, int, int>> circles_ref;
+		for (size_t i = 0; i < seq_result.circles.size(); i++) {
+			circles_ref.push_back(make_tuple(seq_result.circles[i].x, seq_result.circles[i].y, seq_result.circles[i].r));
+		}
+
+		for (int m = 0; m < 3; m++) {
+			for (int l = 0; l < 2; l++) {
+				for (int threads = 1; threads <= 2; threads++) {
+					params.imp_type = ImpType::openmpi;
+					params.mpi_type = mpi_types[m];
+					params.acc_layout = layouts[l];
+					params.omp_threads = threads;
+
+					hough_engine engine(params);
+					const hough_result& result = engine.detect(img);
+					vector<tuple<int, int, int>> found;
+					for (size_t i = 0; i < result.circles.size(); i++) {
+						found.push_back(make_tuple(result.circles[i].x, result.circles[i].y, result.circles[i].r));
+					}
+
+					string name = "mpi " + mpi_names[m] + " (" + to_string(world_size) + " processes, " + to_string(threads) + " thread(s), " +
+						((l == 0) ? "planar" : "radius-inner") + ", " + ((s == 0) ? "angles" : "midpoint") + " stencil)";
+					check(name + " gives the sequential accumulator", hash_ref != 0 && metrics::counter(engine.metrics(), "acc_hash") == hash_ref);
+					check(name + " finds the sequential circles", circles_ref.size() >= 3 && found == circles_ref);
+
+					//the estimate of the largest process (memory budget) matches the buffers it actually holds
+					long long bytes = metrics::counter(engine.metrics(), "mem_peak_bytes"), bytes_max = 0;
+					MPI_Allreduce(&bytes, &bytes_max, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+					check(name + " holds the estimated bytes", bytes_max == result.mem_need);
+				}
+			}
+		}
+	}
+	hough::enable_acc_hash(false);
+}
+
+/*!
+ * \brief Runs all tests, or all MPI tests (argument "mpi", under mpiexec).
+ * \param argc Number of arguments
+ * \param argv Arguments
+ * \return 0 if all tests passed
+ */
+int main(int argc, char** argv) {
+	if (argc > 1 && string(argv[1]) == "mpi") {
+		int world_size;
+		MPI_Init(&argc, &argv);
+		MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+		MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+		if (world_size < 2) {
+			check("mpi tests need at least 2 processes", false);
+		}
+		else {
+			test_mpi_identical(world_size);
+		}
+		MPI_Finalize();
+		if (world_rank != 0) {
+			return 0;
+		}
+	}
+	else {
+		test_small_circle_not_clipped();
+		test_forced_counter_widths();
+		test_backends_identical();
+		test_median_const();
+		test_gaussian_sobel_direction();
+		test_kept_buffers_budget();
+		test_concurrent_engines();
+	}
+
+	cout << (failed == 0 ? "all tests passed" : to_string(failed) + " test(s) failed") << endl;
+	return (failed == 0) ? 0 : 1;
+}
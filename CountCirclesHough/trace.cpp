@@ -0,0 +1,130 @@
+#include "trace.h"
+#include <cstring>
+#include <iomanip>
+
+/*! \brief Tracing on/off. */
+bool trace::enabled = false;
+/*! \brief Timestamp all events are relative to (nanoseconds). */
+long long trace::origin = 0;
+/*! \brief Events of this process recorded since the last write. */
+vector<trace_event> trace::events;
+
+const int trace::mpi_tag;
+
+/*!
+ * \brief Turns tracing on or off.
+ * \param on Tracing on/off
+ */
+void trace::enable(const bool& on) {
+	enabled = on;
+}
+
+/*!
+ * \brief Returns whether tracing is on.
+ */
+bool trace::is_enabled() {
+	return enabled;
+}
+
+/*!
+ * \brief Sets the time origin of all events. With MPI, all processes leave a barrier
+		  together and take their origin right after it, aligning their clocks.
+		  Events recorded before get negative timestamps.
+ * \param use_mpi Synchronize with all MPI processes
+ */
+void trace::sync_clock(const bool& use_mpi) {
+	if (use_mpi) {
+		MPI_Barrier(MPI_COMM_WORLD);
+	}
+	long long now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	for (size_t i = 0; i < events.size(); i++) {
+		events[i].begin += origin - now;
+		events[i].end += origin - now;
+	}
+	origin = now;
+}
+
+/*!
+ * \brief Records a span of the calling OpenMP thread.
+		  Thread-safe, may be called from inside OpenMP parallel regions.
+ * \param name Stage name
+ * \param begin Begin timestamp (\link metrics::now \endlink)
+ * \param end End timestamp (\link metrics::now \endlink)
+ */
+void trace::add(const string& name, const long long& begin, const long long& end) {
+	if (!enabled) {
+		return;
+	}
+
+	trace_event ev;
+	memset(&ev, 0, sizeof(ev));
+	strncpy(ev.name, name.c_str(), sizeof(ev.name) - 1);
+	ev.thread = omp_get_thread_num();
+	ev.begin = begin - origin;
+	ev.end = end - origin;
+
+	#pragma omp critical(trace_events)
+	events.push_back(ev);
+}
+
+/*!
+ * \brief Writes the events recorded since the last write as a Chrome trace-event JSON file
+		  (one process per MPI rank, one thread per OpenMP thread) and drops them, so repeated writes
+		  (GUI reruns) neither resend old events nor grow without bound; each file holds the latest runs only.
+		  With MPI, this is collective: non-root processes send their events to the root, which writes the file.
+ * \param path Output file path
+ * \param world_rank Process ID of an MPI process
+ * \param world_size Number of all MPI processes
+ * \param use_mpi Gather events of all MPI processes
+ */
+void trace::write(const string& path, const int& world_rank, const int& world_size, const bool& use_mpi) {
+	if (!enabled || path.empty()) {
+		return;
+	}
+
+	//take the recorded events, recording may go on while writing
+	vector<trace_event> local;
+	#pragma omp critical(trace_events)
+	local.swap(events);
+
+	if (use_mpi && world_rank != 0) {
+		int cnt = (int)local.size();
+		MPI_Send(&cnt, 1, MPI_INT, 0, mpi_tag, MPI_COMM_WORLD);
+		MPI_Send(local.data(), cnt * (int)sizeof(trace_event), MPI_BYTE, 0, mpi_tag, MPI_COMM_WORLD);
+		return;
+	}
+
+	vector<tuple<int, trace_event>> all; //tuple: rank,event
+	for (size_t i = 0; i < local.size(); i++) {
+		all.push_back(make_tuple(world_rank, local[i]));
+	}
+	if (use_mpi) {
+		for (int i = 1; i < world_size; i++) {
+			int cnt = 0;
+			MPI_Recv(&cnt, 1, MPI_INT, i, mpi_tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			vector<trace_event> rbuf(cnt);
+			MPI_Recv(rbuf.data(), cnt * (int)sizeof(trace_event), MPI_BYTE, i, mpi_tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			for (int k = 0; k < cnt; k++) {
+				all.push_back(make_tuple(i, rbuf[k]));
+			}
+		}
+	}
+
+	stringstream out;
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (int i = 0; i < (use_mpi ? world_size : 1); i++) {
+		out << (i > 0 ? "," : "") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << i << ",\"tid\":0,\"args\":{\"name\":\"rank " << i << "\"}}";
+	}
+	//timestamps and durations in microseconds
+	out << fixed << setprecision(3);
+	for (size_t i = 0; i < all.size(); i++) {
+		const trace_event& ev = get<1>(all[i]);
+		out << ",{\"name\":\"" << ev.name << "\",\"ph\":\"X\",\"pid\":" << get<0>(all[i]) << ",\"tid\":" << ev.thread
+			<< ",\"ts\":" << (ev.begin / 1000.0) << ",\"dur\":" << ((ev.end - ev.begin) / 1000.0) << "}";
+	}
+	out << "]}\n";
+
+	ofstream file(path, ios_base::trunc);
+	file << out.str();
+	file.flush();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "globals.h"
+
+/*! \brief One traced span (plain struct, sent over MPI as bytes). */
+struct trace_event {
+	char name[32]; //!< Stage name (truncated)
+	int thread; //!< OpenMP thread number
+	long long begin; //!< Begin timestamp in nanoseconds, relative to the synchronized origin
+	long long end; //!< End timestamp in nanoseconds, relative to the synchronized origin
+};
+
+/*!
+ * \brief Optional timeline of stage spans per thread and MPI process, written as a Chrome trace-event JSON file.
+		  Tracing is off by default; when off, recording does nothing.
+ * \copyright MIT License
+ * \author 97131004
+ */
+class trace
+{
+private:
+	static bool enabled;
+	static long long origin;
+	static vector<trace_event> events;
+	static const int mpi_tag = 2; //!< MPI tag of the event gather (0 and 1 carry parameters, images and accumulators).
+
+public:
+	static void enable(const bool& on);
+	static bool is_enabled();
+	static void sync_clock(const bool& use_mpi);
+	static void add(const string& name, const long long& begin, const long long& end);
+	static void write(const string& path, const int& world_rank, const int& world_size, const bool& use_mpi);
+};